@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <new>
+#include <type_traits>
+#include <initializer_list>
+#include <utility>
+
+/*
+按键回调:
+
+不分配内存的可调用对象，两种来源：
+	普通函数指针：构造是constexpr的，可以放进编译期构建的分派表
+	小型可平凡拷贝的可调用对象（例如只捕获this或几个引用的lambda）：直接存放在内部缓冲区
+调用只有一次经由函数指针的间接跳转，没有虚函数与堆分配
+*/
+template<typename Key>
+class Key_Callback
+{
+public:
+	using Plain = long(*)(const Key &stKey);
+	constexpr const static inline size_t szStorageSize = 16;//内联存储的可调用对象最大字节数
+
+private:
+	using Thunk = long(*)(const Key_Callback &kcSelf, const Key &stKey);
+
+	Thunk fnThunk;
+	Plain fnPlain;
+	alignas(void *) unsigned char u8Storage[szStorageSize];
+
+private:
+	static long CallPlain(const Key_Callback &kcSelf, const Key &stKey)
+	{
+		return kcSelf.fnPlain(stKey);
+	}
+
+	template<typename F>
+	static long CallStored(const Key_Callback &kcSelf, const Key &stKey)
+	{
+		return (*std::launder(reinterpret_cast<const F *>(kcSelf.u8Storage)))(stKey);
+	}
+
+public:
+	constexpr Key_Callback(void) noexcept :
+		fnThunk(nullptr),
+		fnPlain(nullptr),
+		u8Storage{}
+	{}
+	constexpr Key_Callback(Plain _fnPlain) noexcept :
+		fnThunk(_fnPlain != nullptr ? &CallPlain : nullptr),
+		fnPlain(_fnPlain),
+		u8Storage{}
+	{}
+	template<typename F>
+	requires (!std::is_convertible_v<F, Plain> && !std::is_same_v<std::decay_t<F>, Key_Callback>)
+	Key_Callback(const F &fFunc) noexcept :
+		fnThunk(&CallStored<F>),
+		fnPlain(nullptr),
+		u8Storage{}
+	{
+		//按值存放，拷贝回调就是拷贝字节，所以要求可平凡拷贝与析构
+		static_assert(sizeof(F) <= szStorageSize, "Callable too large for Key_Callback, capture less or bind a pointer");
+		static_assert(alignof(F) <= alignof(void *), "Callable over-aligned for Key_Callback");
+		static_assert(std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>, "Key_Callback only stores trivially copyable callables");
+		::new ((void *)u8Storage) F(fFunc);
+	}
+	~Key_Callback(void) = default;
+
+	constexpr explicit operator bool(void) const noexcept
+	{
+		return fnThunk != nullptr;
+	}
+
+	long operator()(const Key &stKey) const
+	{
+		return fnThunk(*this, stKey);
+	}
+};
+
+/*
+按键分派表:
+
+按键本身就只有9~10bit（见各平台Key::Index），直接作为下标索引一张定长数组，
+查找就是一次数组访问，不需要哈希与桶
+所有绑定都是普通函数时，整张表可以用Build在编译期构建
+*/
+template<typename Key, size_t N>
+class Key_Dispatch
+{
+public:
+	using Callback = Key_Callback<Key>;
+
+private:
+	std::array<Callback, N> arrCallback;
+
+public:
+	constexpr Key_Dispatch(void) noexcept :
+		arrCallback{}
+	{}
+	~Key_Dispatch(void) = default;
+
+	//由(按键, 函数)列表构建，可以在编译期求值
+	constexpr static Key_Dispatch Build(std::initializer_list<std::pair<Key, typename Callback::Plain>> ilBindings) noexcept
+	{
+		Key_Dispatch kdRet{};
+		for (const auto &it : ilBindings)
+		{
+			kdRet.Bind(it.first, it.second);
+		}
+		return kdRet;
+	}
+
+	//绑定，重复绑定则新的替换旧的
+	constexpr Key_Dispatch &Bind(const Key &stKey, const Callback &kcFunc) noexcept
+	{
+		arrCallback[stKey.Index()] = kcFunc;
+		return *this;
+	}
+
+	constexpr void Unbind(const Key &stKey) noexcept
+	{
+		arrCallback[stKey.Index()] = Callback{};
+	}
+
+	constexpr bool Contains(const Key &stKey) const noexcept
+	{
+		return (bool)arrCallback[stKey.Index()];
+	}
+
+	//未绑定时返回nullptr
+	constexpr const Callback *Find(const Key &stKey) const noexcept
+	{
+		const Callback &kcFunc = arrCallback[stKey.Index()];
+		return kcFunc ? &kcFunc : nullptr;
+	}
+
+	constexpr void Clear(void) noexcept
+	{
+		arrCallback.fill(Callback{});
+	}
+};
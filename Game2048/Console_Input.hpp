@@ -2,7 +2,6 @@
 
 #include <functional>
 #include <unordered_set>
-#include <unordered_map>
 #include <stdexcept>
 
 #include <stdio.h>
@@ -11,6 +10,8 @@
 #include <limits.h>
 #include <stdint.h>
 
+#include "Console_Dispatch.hpp"
+
 #define EOL -1
 
 class Console_Input//用户交互
@@ -38,15 +39,19 @@ public:
 			return u16KeyCode != _Right.u16KeyCode || enLeadCode != _Right.enLeadCode;
 		}
 
-		size_t Hash() const noexcept
+		//正常情况下，u16KeyCode只会在0~255，而LeadCode只会在0~3，组成10bit的下标
+		constexpr static const size_t szIndexCount = 1 << 10;
+		constexpr size_t Index() const noexcept
 		{
-			//正常情况下，u16KeyCode只会在0~255，而LeadCode只会在0~3
-			uint16_t u16HashCode = 
+			return
 				(u16KeyCode & 0x00FF) |//留下低8bit
 				((enLeadCode & 0x0003) << 8);//把低2bit移动到8bit前面组成10bit
+		}
 
+		size_t Hash() const noexcept
+		{
 			//求hash
-			return std::hash<uint16_t>{}(u16HashCode);
+			return std::hash<uint16_t>{}((uint16_t)Index());
 		}
 	};
 
@@ -71,6 +76,10 @@ public:
 		constexpr static const Key SHIFT_N = { 'N', Code_NL };
 		constexpr static const Key SHIFT_Q = { 'Q', Code_NL };
 		constexpr static const Key SHIFT_R = { 'R', Code_NL };
+		constexpr static const Key Z = { 'z', Code_NL };
+		constexpr static const Key SHIFT_Z = { 'Z', Code_NL };
+		constexpr static const Key X = { 'x', Code_NL };
+		constexpr static const Key SHIFT_X = { 'X', Code_NL };
 	};
 
 	struct KeyHash
@@ -82,11 +91,16 @@ public:
 	};
 
 	using CallBackFunc = long(const Key& stKey);
-	using Func = std::function<CallBackFunc>;
+	using Func = Key_Callback<Key>;//不分配内存的回调，见Console_Dispatch.hpp
+	using Dispatch = Key_Dispatch<Key, Key::szIndexCount>;
 private:
-	std::unordered_map<Key, Func, KeyHash> mapRegisterTable;
+	Dispatch kdRegisterTable;//按按键下标直接索引的回调表
 public:
 	Console_Input(void) = default;
+	//用预先（可以是编译期）构建好的分派表初始化
+	explicit Console_Input(const Dispatch &_kdRegisterTable) :
+		kdRegisterTable(_kdRegisterTable)
+	{}
 	~Console_Input(void) = default;
 
 	//可以移动
@@ -117,31 +131,32 @@ public:
 	//注册键，重复注册则最新的按键替换最旧的
 	void RegisterKey(const Key &stKey, Func fFunc)
 	{
-		mapRegisterTable[stKey] = fFunc;
+		kdRegisterTable.Bind(stKey, fFunc);
 	}
 
 	//通过拷贝注册相同功能按键
 	void CopyRegisteredKey(const Key &stTarget, const Key &stSource)
 	{
-		mapRegisterTable[stTarget] = mapRegisterTable[stSource];
+		const Func *pFunc = kdRegisterTable.Find(stSource);
+		kdRegisterTable.Bind(stTarget, pFunc != nullptr ? *pFunc : Func{});
 	}
 
 	//取消注册
 	void UnRegisterKey(const Key &stKey) noexcept
 	{
-		mapRegisterTable.erase(stKey);
+		kdRegisterTable.Unbind(stKey);
 	}
 
 	//查询是否已经注册
 	bool IsKeyRegister(const Key &stKey) const noexcept
 	{
-		return mapRegisterTable.contains(stKey);
+		return kdRegisterTable.Contains(stKey);
 	}
 
 	//重置所有已注册按键
 	void Reset(void) noexcept
 	{
-		mapRegisterTable.clear();
+		kdRegisterTable.Clear();
 	}
 
 	//获取按键转义码（如果有转义）并返回
@@ -196,20 +211,27 @@ public:
 		return stKeyGet;//顺便返回一下让用户知道是哪个
 	}
 
-	//处理一次按键并触发回调并返回回调返回值
-	long Once(void) const//不保证函数会不会抛出异常
+	//对一个已经读到的按键触发回调，按键未注册则返回false（按键可以来自任何输入源）
+	bool Trigger(const Key &stKey, long &lRet) const
 	{
-		Key stKetGet = GetTranslateKey();
-
 		//获取函数
-		auto it = mapRegisterTable.find(stKetGet);
-		if (it == mapRegisterTable.end())
+		const Func *pFunc = kdRegisterTable.Find(stKey);
+		if (pFunc == nullptr)
 		{
-			return LONG_MIN;
+			return false;
 		}
 
 		//不为空则调用
-		return it->second(it->first);
+		lRet = (*pFunc)(stKey);
+		return true;
+	}
+
+	//处理一次按键并触发回调并返回回调返回值
+	long Once(void) const//不保证函数会不会抛出异常
+	{
+		long lRet = LONG_MIN;
+		Trigger(GetTranslateKey(), lRet);
+		return lRet;
 	}
 
 	long AtLeastOne(void) const
@@ -223,6 +245,28 @@ public:
 		return lRet;
 	}
 
+	//至少处理一个已注册按键，然后把缓冲区里已经存在的按键全部处理掉，调用者每帧只需要绘制一次
+	//任一回调返回-1立即返回-1，否则返回所有回调返回值中的最大值
+	long Drain(void) const
+	{
+		long lRet = AtLeastOne();
+		while (lRet != -1 && InputExists())
+		{
+			long lNext = Once();
+			if (lNext == LONG_MIN)
+			{
+				continue;
+			}
+			if (lNext == -1)
+			{
+				return -1;
+			}
+			lRet = lNext > lRet ? lNext : lRet;
+		}
+
+		return lRet;
+	}
+
 	//死循环处理按键并触发回调直到抛出异常或回调返回非0值
 	long Loop(void) const
 	{
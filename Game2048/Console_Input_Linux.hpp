@@ -1,7 +1,8 @@
 #pragma once
 
 #include <cstdio>
-#include <cassert>
+#include <cerrno>
+#include <cstring>
 #include <functional>
 #include <cstdint>
 #include <cstdio>
@@ -9,10 +10,13 @@
 #include <optional>
 #include <print>
 #include <stdexcept>
+#include <poll.h>
 #include <termios.h>
 #include <unistd.h>
 #include <unordered_set>
 
+#include "Console_Dispatch.hpp"
+
 class Console_Input
 {
 	public:
@@ -27,9 +31,13 @@ class Console_Input
 			bool operator!=(const Key& rhs) const noexcept {
 				return u16KeyCode != rhs.u16KeyCode || escape != rhs.escape;
 			}
+			// A byte plus the escape flag: 9 bits, used directly as a table index.
+			static constexpr size_t IndexCount = 1 << 9;
+			constexpr size_t Index() const noexcept {
+				return (unsigned char)u16KeyCode | (size_t)escape << 8;
+			}
 			size_t Hash() const noexcept {
-				std::uint16_t hash = u16KeyCode | escape<<8;
-				return std::hash<uint16_t>{}(hash);
+				return std::hash<uint16_t>{}((std::uint16_t)Index());
 			}
 		};
 
@@ -54,6 +62,10 @@ class Console_Input
 			constexpr static const Key SHIFT_N = { 'N', false };
 			constexpr static const Key SHIFT_Q = { 'Q', false };
 			constexpr static const Key SHIFT_R = { 'R', false };
+			constexpr static const Key Z = { 'z', false };
+			constexpr static const Key SHIFT_Z = { 'Z', false };
+			constexpr static const Key X = { 'x', false };
+			constexpr static const Key SHIFT_X = { 'X', false };
 		};
 
 		struct KeyHash {
@@ -63,11 +75,186 @@ class Console_Input
 		};
 
 
-		using Func = std::function<long(const Key& stKey)>;
+		// Non-allocating callback, see Console_Dispatch.hpp.
+		using Func = Key_Callback<Key>;
+		using Dispatch = Key_Dispatch<Key, Key::IndexCount>;
 	private:
-		std::unordered_map<Key, Func, KeyHash> mapRegisterTable;
+		Dispatch registerTable;
 		termios original;
+
+		// Raw bytes read from stdin and the keys parsed from them. stdin is
+		// process-wide, so this state is shared by every instance.
+		struct InputState {
+			static constexpr size_t RawCapacity = 1024;
+			static constexpr size_t QueueCapacity = 256;
+
+			unsigned char raw[RawCapacity];
+			size_t rawBegin = 0;
+			size_t rawEnd = 0;
+
+			Key queue[QueueCapacity];
+			size_t queueHead = 0;
+			size_t queueCount = 0;
+
+			bool coalesce = false;
+		};
+		static InputState& State(void) noexcept {
+			static InputState instance{};
+			return instance;
+		}
+
+		// How long to wait for the rest of an escape sequence split across reads
+		// before treating the ESC byte as a key on its own.
+		static constexpr int EscapeTimeoutMs = 30;
+
+		// Wait up to timeoutMs (-1 = forever) for input, then read everything
+		// available in one syscall. Returns false on timeout.
+		static bool ReadAvailable(int timeoutMs) {
+			InputState& state = State();
+			if (state.rawBegin != 0) {
+				std::memmove(state.raw, state.raw + state.rawBegin, state.rawEnd - state.rawBegin);
+				state.rawEnd -= state.rawBegin;
+				state.rawBegin = 0;
+			}
+			if (state.rawEnd == InputState::RawCapacity) {
+				return false;
+			}
+
+			pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+			int ready = poll(&pfd, 1, timeoutMs);
+			if (ready < 0) {
+				if (errno == EINTR) {
+					return false;
+				}
+				throw std::runtime_error("Error: poll() failed on stdin");
+			}
+			if (ready == 0) {
+				return false;
+			}
+
+			ssize_t got = read(STDIN_FILENO, state.raw + state.rawEnd, InputState::RawCapacity - state.rawEnd);
+			if (got == 0) {
+				throw std::runtime_error("Error: EOF encountered in stdin");
+			}
+			if (got < 0) {
+				if (errno == EINTR || errno == EAGAIN) {
+					return false;
+				}
+				throw std::runtime_error("Error: read() failed on stdin");
+			}
+			state.rawEnd += (size_t)got;
+			return true;
+		}
+
+		static void PushKey(const Key& key) {
+			InputState& state = State();
+			state.queue[(state.queueHead + state.queueCount) % InputState::QueueCapacity] = key;
+			++state.queueCount;
+		}
+
+		// Parse as many complete keys as the raw buffer holds and the queue has
+		// room for; whatever is left stays buffered for the next call. A trailing
+		// partial escape sequence is kept for the next read unless flush is set,
+		// in which case the ESC byte becomes a key by itself. With coalescing on, a key
+		// repeated back to back within one burst is queued only once.
+		static void ParseBuffered(bool flush) {
+			InputState& state = State();
+			bool haveLast = false;
+			Key last = {};
+
+			auto emit = [&](const Key& key) {
+				if (state.coalesce && haveLast && key == last) {
+					return;
+				}
+				PushKey(key);
+				last = key;
+				haveLast = true;
+			};
+
+			const unsigned char* raw = state.raw;
+			size_t i = state.rawBegin;
+			size_t end = state.rawEnd;
+			while (i < end && state.queueCount < InputState::QueueCapacity) {
+				if (raw[i] != 0x1b) {
+					emit(Key{ (char)raw[i], false });
+					++i;
+					continue;
+				}
+
+				// ESC '[' or ESC 'O', then parameter bytes, then one final byte.
+				if (i + 1 < end && raw[i + 1] != '[' && raw[i + 1] != 'O') {
+					emit(Key{ 0x1b, false }); // Lone ESC followed by an ordinary key.
+					++i;
+					continue;
+				}
+
+				size_t j = i + 2;
+				while (j < end && raw[j] >= 0x20 && raw[j] <= 0x3f) {
+					++j;
+				}
+				if (i + 1 >= end || j >= end) {
+					if (!flush) {
+						break; // Wait for the rest of the sequence.
+					}
+					emit(Key{ 0x1b, false });
+					++i;
+					continue;
+				}
+
+				unsigned char final = raw[j];
+				if (final < 0x40 || final > 0x7e) {
+					emit(Key{ 0x1b, false }); // Malformed, keep the bytes as ordinary keys.
+					++i;
+					continue;
+				}
+
+				// PgDn(6), PgUp(5) and Delete(3) end with '~' and are keyed by their digit.
+				char code = (char)final;
+				if (final == '~' && j > i + 2 && raw[i + 2] >= '0' && raw[i + 2] <= '9') {
+					code = (char)raw[i + 2];
+				}
+				emit(Key{ code, true });
+				i = j + 1;
+			}
+			state.rawBegin = i;
+		}
+
+		// Read one burst and parse it, finishing any escape sequence split across reads.
+		static void Pump(int timeoutMs) {
+			InputState& state = State();
+			// Drain what a full queue left behind before waiting on stdin again.
+			if (state.rawBegin != state.rawEnd) {
+				ParseBuffered(false);
+				if (state.queueCount != 0) {
+					return;
+				}
+			}
+			if (!ReadAvailable(timeoutMs)) {
+				return;
+			}
+			ParseBuffered(false);
+
+			while (state.rawBegin != state.rawEnd && state.queueCount != InputState::QueueCapacity) {
+				if (!ReadAvailable(EscapeTimeoutMs)) {
+					ParseBuffered(true);
+					break;
+				}
+				ParseBuffered(false);
+			}
+		}
+
+		static Key PopKey(void) {
+			InputState& state = State();
+			Key ret = state.queue[state.queueHead];
+			state.queueHead = (state.queueHead + 1) % InputState::QueueCapacity;
+			--state.queueCount;
+			return ret;
+		}
 	public:
+	// Start from a prebuilt (possibly constexpr) dispatch table.
+	explicit Console_Input(const Dispatch& table) : Console_Input() {
+		registerTable = table;
+	}
 	Console_Input(void) {
 		termios raw;
 		tcgetattr(STDIN_FILENO, &raw);
@@ -87,31 +274,29 @@ class Console_Input
 	Console_Input &operator = (const Console_Input &) = delete;
 
 	static Key GetTranslateKey(void) {
-		Key ret;
-		auto ch = std::getchar();
-		char tmp;
-		switch (ch)
-		{
-			case 0x1b:
-				ret.escape = true;
-				tmp = std::getchar();
-				assert(tmp == '['); // This is guaranteed to be '['
-				ret.u16KeyCode = std::getchar();
-				if (ret.u16KeyCode >= '0' && ret.u16KeyCode <= '9') {
-					// An extra char for PgDn(6), PgUp(5) and Delete(3)
-					tmp = std::getchar();
-					assert(tmp == '~');
-				}
-				break;
+		InputState& state = State();
+		// Prompts are printed without a newline; show them before blocking.
+		fflush(stdout);
+		while (state.queueCount == 0) {
+			Pump(-1);
+		}
+		return PopKey();
+	}
 
-			case EOF:
-				throw std::runtime_error("Error: EOF encountered in stdin");
-			default:
-				ret.u16KeyCode = ch;
-				ret.escape = false;
-				break;
+	// Whether a key is already waiting. Never blocks.
+	static bool InputExists(void) {
+		InputState& state = State();
+		if (state.queueCount == 0) {
+			Pump(0);
 		}
-		return ret;
+		return state.queueCount != 0;
+	}
+
+	// Merge a key repeated back to back within one read (e.g. a held arrow key
+	// the game could not keep up with) into a single event.
+	static void SetCoalesce(bool enable) noexcept {
+		InputState& state = State();
+		state.coalesce = enable;
 	}
 
 	static void WaitForKey(Key target) {
@@ -130,14 +315,24 @@ class Console_Input
 		return get;
 	}
 
+	// Run the callback bound to a key that was already read (from any source).
+	// Returns false if the key is not registered.
+	bool Trigger(const Key& key, long& ret) const {
+		const Func* func = registerTable.Find(key);
+		if (func == nullptr) {
+			return false;
+		}
+
+		ret = (*func)(key);
+		return true;
+	}
+
 	std::optional<long> Once(void) const {
-		Key get = GetTranslateKey();
-		auto it = mapRegisterTable.find(get);
-		if (it == mapRegisterTable.end()) {
+		long ret = 0;
+		if (!Trigger(GetTranslateKey(), ret)) {
 			return {};
 		}
-
-		return it->second(it->first);
+		return ret;
 	}
 
 	long AtLeastOne(void) const {
@@ -148,12 +343,42 @@ class Console_Input
 		return ret.value();
 	}
 
+	// Wait for one registered key, then handle every key that is already
+	// queued, so the caller redraws once per frame instead of once per key.
+	// Returns -1 as soon as a callback does, otherwise the largest result.
+	long Drain(void) const {
+		long ret = AtLeastOne();
+		while (ret != -1 && InputExists()) {
+			std::optional<long> next = Once();
+			if (!next.has_value()) {
+				continue;
+			}
+			if (next.value() == -1) {
+				return -1;
+			}
+			ret = next.value() > ret ? next.value() : ret;
+		}
+		return ret;
+	}
+
 	static Key WaitAnyKey(void) noexcept {
 		return GetTranslateKey();
 	}
 
 	void RegisterKey(const Key& key, Func callback) {
-		mapRegisterTable[key] = callback;
+		registerTable.Bind(key, callback);
+	}
+
+	void UnRegisterKey(const Key& key) noexcept {
+		registerTable.Unbind(key);
+	}
+
+	bool IsKeyRegister(const Key& key) const noexcept {
+		return registerTable.Contains(key);
+	}
+
+	void Reset(void) noexcept {
+		registerTable.Clear();
 	}
 
 };
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Game_Stats.hpp"
+
+/*
+差量渲染:
+
+在内存中维护一块字符网格（当前帧与上一帧），调用者先把整帧画进网格，
+Flush时逐行比较两帧，只为发生变化的字符段输出光标定位与文本，
+最后把整帧输出拼成一个缓冲区，用一次write写到终端
+*/
+class Console_Renderer
+{
+private:
+	uint16_t u16Rows;//网格行数
+	uint16_t u16Cols;//网格列数
+	uint16_t u16OriginX;//网格左上角在控制台中的列，从1开始
+	uint16_t u16OriginY;//网格左上角在控制台中的行，从1开始
+
+	std::vector<char> vecPrev;//上一帧（已经在终端上的内容）
+	std::vector<char> vecNext;//正在绘制的帧
+	bool bPrevValid;//上一帧是否可信，屏幕被清空或首次绘制时为false，此时全量重绘
+
+	std::string strOut;//本帧输出缓冲，复用避免每帧分配
+
+	uint64_t u64Frames;//已输出的帧数
+	uint64_t u64BytesWritten;//已写入终端的字节数
+
+private:
+	//两段变化之间相隔不超过此数的未变化字符直接重写，比再输出一次光标定位更短
+	constexpr const static inline uint16_t u16MergeGap = 6;
+
+	void AppendCursor(uint16_t u16Row, uint16_t u16Col)
+	{
+		char cBuf[32];
+		int iLen = snprintf(cBuf, sizeof(cBuf), "\033[%u;%uH", (unsigned)(u16OriginY + u16Row), (unsigned)(u16OriginX + u16Col));
+		strOut.append(cBuf, (size_t)iLen);
+	}
+
+	static void WriteAll(const char *pData, size_t szLen)
+	{
+		//先把stdio缓冲里的内容（例如提示信息）冲出去，保证顺序
+		fflush(stdout);
+
+		while (szLen != 0)
+		{
+#ifdef _WIN32
+			int iRet = _write(1, pData, (unsigned int)szLen);
+#else
+			ssize_t iRet = write(STDOUT_FILENO, pData, szLen);
+#endif
+			if (iRet <= 0)
+			{
+				return;//终端已经不可写，放弃本帧
+			}
+			pData += iRet;
+			szLen -= (size_t)iRet;
+		}
+	}
+
+public:
+	Console_Renderer(uint16_t _u16Rows, uint16_t _u16Cols, uint16_t _u16OriginX = 1, uint16_t _u16OriginY = 1) :
+		u16Rows(_u16Rows),
+		u16Cols(_u16Cols),
+		u16OriginX(_u16OriginX),
+		u16OriginY(_u16OriginY),
+
+		vecPrev((size_t)_u16Rows * _u16Cols, ' '),
+		vecNext((size_t)_u16Rows * _u16Cols, ' '),
+		bPrevValid(false),
+
+		strOut(),
+
+		u64Frames(0),
+		u64BytesWritten(0)
+	{
+		strOut.reserve((size_t)_u16Rows * (_u16Cols + 16) + 32);
+	}
+	~Console_Renderer(void) = default;
+
+	//禁止拷贝，两个渲染器对应同一块屏幕没有意义
+	Console_Renderer(const Console_Renderer &) = delete;
+	Console_Renderer &operator=(const Console_Renderer &) = delete;
+
+	//在当前帧的(u16Row, u16Col)处写入文本，超出网格的部分截断
+	void Draw(uint16_t u16Row, uint16_t u16Col, const char *pText)
+	{
+		if (u16Row >= u16Rows)
+		{
+			return;
+		}
+
+		char *pDst = vecNext.data() + (size_t)u16Row * u16Cols;
+		for (; *pText != '\0' && u16Col < u16Cols; ++pText, ++u16Col)
+		{
+			pDst[u16Col] = *pText;
+		}
+	}
+
+	//把当前帧清成空白，布局会变化（例如格子变宽又变窄）时每帧先调用，避免残留上一帧的字符
+	void Clear(void) noexcept
+	{
+		std::fill(vecNext.begin(), vecNext.end(), ' ');
+	}
+
+	//屏幕被外部清空或覆盖后调用，下一次Flush全量重绘
+	void Invalidate(void) noexcept
+	{
+		bPrevValid = false;
+	}
+
+	//比较两帧并一次性输出差异，返回写入的字节数
+	size_t Flush(void)
+	{
+		strOut.clear();
+
+		for (uint16_t r = 0; r < u16Rows; ++r)
+		{
+			const char *pPrev = vecPrev.data() + (size_t)r * u16Cols;
+			const char *pNext = vecNext.data() + (size_t)r * u16Cols;
+
+			uint16_t c = 0;
+			while (c < u16Cols)
+			{
+				if (bPrevValid && pPrev[c] == pNext[c])
+				{
+					++c;
+					continue;
+				}
+
+				//找到一段变化，向后延伸，中间的短间隔一起重写
+				uint16_t u16Beg = c;
+				uint16_t u16End = c + 1;
+				uint16_t u16Gap = 0;
+				for (uint16_t k = u16End; k < u16Cols && u16Gap <= u16MergeGap; ++k)
+				{
+					if (!bPrevValid || pPrev[k] != pNext[k])
+					{
+						u16End = k + 1;
+						u16Gap = 0;
+					}
+					else
+					{
+						++u16Gap;
+					}
+				}
+
+				AppendCursor(r, u16Beg);
+				strOut.append(pNext + u16Beg, (size_t)(u16End - u16Beg));
+				c = u16End;
+			}
+		}
+
+		vecPrev = vecNext;
+		bPrevValid = true;
+
+		if (strOut.empty())
+		{
+			return 0;
+		}
+
+		//\033[?25l 隐藏光标，每帧都要设置因为用户修改控制台窗口后光标可能恢复显示，最后把光标停在网格下方
+		strOut.insert(0, "\033[?25l");
+		AppendCursor(u16Rows, 0);
+
+		WriteAll(strOut.data(), strOut.size());
+
+		++u64Frames;
+		u64BytesWritten += strOut.size();
+		Game2048_Stats::Add(Game2048_Stats::FrameRender);
+		Game2048_Stats::Add(Game2048_Stats::BytesWrite, strOut.size());
+		return strOut.size();
+	}
+
+	uint64_t GetFrames(void) const noexcept
+	{
+		return u64Frames;
+	}
+
+	uint64_t GetBytesWritten(void) const noexcept
+	{
+		return u64BytesWritten;
+	}
+};
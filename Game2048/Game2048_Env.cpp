@@ -0,0 +1,53 @@
+//向量化环境动态库：g++ -std=c++20 -O2 -shared -fPIC -fvisibility=hidden -DGAME2048_ENV_BUILD Game2048_Env.cpp -o libgame2048env.so
+
+#include <new>
+
+#include "Game2048_Env.h"
+#include "Game_VecEnv.hpp"
+#include "Game_Replay.hpp"
+
+static_assert(GAME2048_ENV_CELLS == Vector_Env::u64Cells && GAME2048_ENV_PLANES == Vector_Env::u64Planes, "C header layout must match Vector_Env");
+
+struct Game2048_Env
+{
+	Vector_Env veGames;
+};
+
+//异常不能穿过C接口，分配失败时返回NULL
+extern "C" Game2048_Env *Game2048_Env_Create(uint64_t u64Count, double dSpawnWeights_2, double dSpawnWeights_4)
+{
+	//与回放格式同一套权重校验，NaN/Inf也在此拒绝
+	if (u64Count == 0 || !Replay_Format::ValidWeights(dSpawnWeights_2, dSpawnWeights_4))
+	{
+		return NULL;
+	}
+
+	try
+	{
+		return new Game2048_Env{ Vector_Env{ u64Count, dSpawnWeights_2, dSpawnWeights_4 } };
+	}
+	catch (const std::bad_alloc &)
+	{
+		return NULL;
+	}
+}
+
+extern "C" void Game2048_Env_Destroy(Game2048_Env *pEnv)
+{
+	delete pEnv;
+}
+
+extern "C" uint64_t Game2048_Env_Size(const Game2048_Env *pEnv)
+{
+	return pEnv->veGames.Size();
+}
+
+extern "C" void Game2048_Env_Reset(Game2048_Env *pEnv, const uint64_t *pSeeds, uint8_t *pObs, uint8_t *pLegal)
+{
+	pEnv->veGames.Reset(pSeeds, pObs, pLegal);
+}
+
+extern "C" uint64_t Game2048_Env_Step(Game2048_Env *pEnv, const uint8_t *pActions, uint8_t *pObs, float *pReward, uint8_t *pDone, uint8_t *pLegal, uint64_t *pEpisodeScore)
+{
+	return pEnv->veGames.Step(pActions, pObs, pReward, pDone, pLegal, pEpisodeScore);
+}
@@ -0,0 +1,54 @@
+#ifndef GAME2048_ENV_H
+#define GAME2048_ENV_H
+
+/*
+向量化环境的C接口（实现见Game2048_Env.cpp与Game_VecEnv.hpp）:
+
+单独编译为动态库，供其它语言（例如Python的ctypes）直接调用，所有缓冲区由调用者分配并在每一步复用
+缓冲区布局（N为局数）：
+	观测	uint8_t [N][GAME2048_ENV_PLANES][GAME2048_ENV_CELLS]，指数平面，第e个平面上指数为e的格子为1
+	奖励	float [N]
+	结束	uint8_t [N]
+	合法	uint8_t [N]，第d位对应方向d（0上 1下 2左 3右）
+	动作	uint8_t [N]，取值同方向
+*/
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifdef GAME2048_ENV_BUILD
+#define GAME2048_ENV_API __declspec(dllexport)
+#else
+#define GAME2048_ENV_API __declspec(dllimport)
+#endif
+#else
+#define GAME2048_ENV_API __attribute__((visibility("default")))
+#endif
+
+#define GAME2048_ENV_CELLS 16
+#define GAME2048_ENV_PLANES 16
+#define GAME2048_ENV_OBS_SIZE (GAME2048_ENV_PLANES * GAME2048_ENV_CELLS)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Game2048_Env Game2048_Env;
+
+/* 创建u64Count局游戏，失败返回NULL；创建后需要先Reset */
+GAME2048_ENV_API Game2048_Env *Game2048_Env_Create(uint64_t u64Count, double dSpawnWeights_2, double dSpawnWeights_4);
+GAME2048_ENV_API void Game2048_Env_Destroy(Game2048_Env *pEnv);
+GAME2048_ENV_API uint64_t Game2048_Env_Size(const Game2048_Env *pEnv);
+
+/* 所有局重开，pSeeds[i]为第i局的种子，为NULL时接着用各局现在的随机数流；输出缓冲区可以为NULL */
+GAME2048_ENV_API void Game2048_Env_Reset(Game2048_Env *pEnv, const uint64_t *pSeeds, uint8_t *pObs, uint8_t *pLegal);
+
+/* 每局执行一个动作，结束（赢或输）的局自动重开，观测与合法掩码为重开后的局面
+   pEpisodeScore不为NULL时写入结束的局的总得分；返回这一步结束的局数；输出缓冲区可以为NULL */
+GAME2048_ENV_API uint64_t Game2048_Env_Step(Game2048_Env *pEnv, const uint8_t *pActions, uint8_t *pObs, float *pReward, uint8_t *pDone, uint8_t *pLegal, uint64_t *pEpisodeScore);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
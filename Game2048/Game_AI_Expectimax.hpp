@@ -0,0 +1,302 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <optional>
+
+#include "Game_Board.hpp"
+#include "Game_Symmetry.hpp"
+#include "Game_TransTable.hpp"
+#include "Game_NTuple.hpp"
+
+/*
+期望最大化（Expectimax）搜索:
+
+最大节点：玩家在四个方向中选择期望值最大的一个
+机会节点：在每个空格以valueDist相同的权重随机生成2或4，取加权平均
+到达深度上限或当前分支的累计概率低于阈值时，直接用启发式函数估值
+机会节点的结果按(棋盘, 剩余深度)缓存在置换表中，重复局面直接复用
+估值与生成概率在旋转、翻转下都不变，置换表按棋盘的规范形式存储，互相对称的局面共用一项
+置换表可以是自己的（每次搜索只用本次写入的项，结果可以复现），也可以由多个线程上的搜索共用同一张（无锁，保留之前搜索的项，见Game_TransTable.hpp）
+叶节点也可以用训练好的N元组网络估值（见Game_NTuple.hpp），网络估的是往后的得分，这时每一步的合并得分也计入期望值
+*/
+class Expectimax_AI
+{
+public:
+	struct Config
+	{
+		uint64_t u64MaxDepth = 3;//最大节点层数（玩家移动次数，包括根节点，至少为1）
+		double dProbThreshold = 0.0001;//分支累计概率低于此值直接估值
+		double dSpawnWeights_2 = 0.9;//生成2的权重，与Game2048构造参数一致
+		double dSpawnWeights_4 = 0.1;//生成4的权重
+		uint64_t u64CacheBits = 18;//自己的置换表大小为2^u64CacheBits项
+		Transposition_Table *pSharedTable = nullptr;//不为空则使用这张共享的置换表，不再分配自己的
+		const NTuple_Network *pEvaluator = nullptr;//不为空则叶节点用这个网络估值，代替启发式函数
+	};
+
+	struct SearchResult
+	{
+		Direction dBest;//最佳方向，没有任何合法移动时为Enum_End
+		double dMoveValue[Direction::Enum_End];//每个方向的期望值，非法方向为0
+		uint64_t u64Nodes;//本次搜索展开的节点数
+	};
+
+private:
+	//====================启发式估值====================
+	/*
+	对每一行（列）预先计算估值并查表，整盘估值为4行加4列之和
+	偏好：空格多、可合并的相邻多、单调、大数少
+	*/
+	class HeuristicTable
+	{
+	private:
+		constexpr const static inline double dLostPenalty = 200000.0;
+		constexpr const static inline double dMonotonicityPower = 4.0;
+		constexpr const static inline double dMonotonicityWeight = 47.0;
+		constexpr const static inline double dSumPower = 3.5;
+		constexpr const static inline double dSumWeight = 11.0;
+		constexpr const static inline double dMergesWeight = 700.0;
+		constexpr const static inline double dEmptyWeight = 270.0;
+
+		float arrRowScore[MoveTable::szRowCount];
+
+	private:
+		HeuristicTable(void) noexcept
+		{
+			for (size_t i = 0; i < MoveTable::szRowCount; ++i)
+			{
+				uint8_t u8Line[4] =
+				{
+					(uint8_t)((i >> 0) & 0xF),
+					(uint8_t)((i >> 4) & 0xF),
+					(uint8_t)((i >> 8) & 0xF),
+					(uint8_t)((i >> 12) & 0xF),
+				};
+
+				double dSum = 0.0;
+				uint64_t u64Empty = 0;
+				uint64_t u64Merges = 0;
+
+				uint8_t u8Prev = 0;
+				uint64_t u64Counter = 0;
+				for (uint8_t u8Rank : u8Line)
+				{
+					dSum += pow(u8Rank, dSumPower);
+					if (u8Rank == 0)
+					{
+						++u64Empty;
+						continue;
+					}
+
+					//连续相同的格子计为可合并
+					if (u8Prev == u8Rank)
+					{
+						++u64Counter;
+					}
+					else if (u64Counter > 0)
+					{
+						u64Merges += 1 + u64Counter;
+						u64Counter = 0;
+					}
+					u8Prev = u8Rank;
+				}
+				if (u64Counter > 0)
+				{
+					u64Merges += 1 + u64Counter;
+				}
+
+				double dMonoLeft = 0.0;
+				double dMonoRight = 0.0;
+				for (uint64_t j = 1; j < 4; ++j)
+				{
+					double dPrev = pow(u8Line[j - 1], dMonotonicityPower);
+					double dCur = pow(u8Line[j], dMonotonicityPower);
+					if (u8Line[j - 1] > u8Line[j])
+					{
+						dMonoLeft += dPrev - dCur;
+					}
+					else
+					{
+						dMonoRight += dCur - dPrev;
+					}
+				}
+
+				arrRowScore[i] = (float)(dLostPenalty +
+					dEmptyWeight * u64Empty +
+					dMergesWeight * u64Merges -
+					dMonotonicityWeight * (dMonoLeft < dMonoRight ? dMonoLeft : dMonoRight) -
+					dSumWeight * dSum);
+			}
+		}
+
+	public:
+		static const HeuristicTable &Get(void) noexcept
+		{
+			static const HeuristicTable htInstance{};
+			return htInstance;
+		}
+
+		double Evaluate(const BitBoard &bbBoard) const noexcept
+		{
+			BitBoard bbTrans = bbBoard.Transpose();
+
+			double dScore = 0.0;
+			for (uint64_t i = 0; i < BitBoard::u64Height; ++i)
+			{
+				dScore += arrRowScore[bbBoard.GetRow(i)];
+				dScore += arrRowScore[bbTrans.GetRow(i)];
+			}
+			return dScore;
+		}
+	};
+
+private:
+	Config cfgSearch;
+	double dProb2;//归一化后生成2的概率
+	double dProb4;//归一化后生成4的概率
+
+	std::optional<Transposition_Table> optOwnTable;//没有共享表时才构造
+	Transposition_Table *pTable;//实际使用的置换表，键为规范形式，深度为剩余深度
+
+	uint64_t u64Nodes;
+
+private:
+	//启发式函数评价的是局面本身，不计得分；网络估值是往后的得分，要加上这一步的得分才能与其它方向比较
+	double MoveReward(const BitBoard::MoveResult &mrMove) const noexcept
+	{
+		return cfgSearch.pEvaluator != nullptr ? (double)mrMove.u32Score : 0.0;
+	}
+
+	double MaxNode(const BitBoard &bbBoard, double dProb, uint64_t u64Depth)
+	{
+		++u64Nodes;
+
+		double dBest = 0.0;//无路可走则为0，即最差
+		for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+		{
+			BitBoard::MoveResult mrMove = bbBoard.Move((Direction)d);
+			if (!mrMove.bChanged)
+			{
+				continue;
+			}
+
+			double dValue = MoveReward(mrMove) + ChanceNode(mrMove.bbBoard, dProb, u64Depth);
+			dBest = dValue > dBest ? dValue : dBest;
+		}
+
+		return dBest;
+	}
+
+	//u64Depth为剩余的最大节点层数
+	double ChanceNode(const BitBoard &bbBoard, double dProb, uint64_t u64Depth)
+	{
+		if (u64Depth == 0 || dProb < cfgSearch.dProbThreshold)
+		{
+			return cfgSearch.pEvaluator != nullptr ? cfgSearch.pEvaluator->Evaluate(bbBoard) : HeuristicTable::Get().Evaluate(bbBoard);
+		}
+
+		//剩余深度不小于所需的结果才可用
+		uint64_t u64Key = Board_Symmetry::CanonicalBoard(bbBoard).GetRaw();
+		float fCached = 0.0f;
+		if (pTable->Lookup(u64Key, (uint16_t)u64Depth, fCached))
+		{
+			return fCached;
+		}
+
+		++u64Nodes;
+
+		uint16_t u16EmptyMask = bbBoard.EmptyMask();
+		uint64_t u64EmptyCount = std::popcount(u16EmptyMask);
+		double dCellProb = dProb / (double)u64EmptyCount;
+
+		double dSum = 0.0;
+		for (; u16EmptyMask != 0; u16EmptyMask &= u16EmptyMask - 1)//只遍历空格
+		{
+			uint64_t i = std::countr_zero(u16EmptyMask);
+			BitBoard bbSpawn = bbBoard;
+
+			bbSpawn.SetExp(i, 1);
+			dSum += MaxNode(bbSpawn, dCellProb * dProb2, u64Depth - 1) * dProb2;
+
+			bbSpawn.SetExp(i, 2);
+			dSum += MaxNode(bbSpawn, dCellProb * dProb4, u64Depth - 1) * dProb4;
+		}
+		double dValue = dSum / (double)u64EmptyCount;
+
+		pTable->Store(u64Key, (uint16_t)u64Depth, (float)dValue);
+
+		return dValue;
+	}
+
+public:
+	Expectimax_AI(void) : Expectimax_AI(Config{})
+	{}
+	explicit Expectimax_AI(const Config &_cfgSearch) :
+		cfgSearch(_cfgSearch),
+		dProb2(_cfgSearch.dSpawnWeights_2 / (_cfgSearch.dSpawnWeights_2 + _cfgSearch.dSpawnWeights_4)),
+		dProb4(_cfgSearch.dSpawnWeights_4 / (_cfgSearch.dSpawnWeights_2 + _cfgSearch.dSpawnWeights_4)),
+		optOwnTable(),
+		pTable(_cfgSearch.pSharedTable),
+		u64Nodes(0)
+	{
+		if (pTable == nullptr)
+		{
+			pTable = &optOwnTable.emplace(_cfgSearch.u64CacheBits, false);//自己的表每次搜索都从空表开始，结果可以复现
+		}
+
+		//提前构建查找表，避免第一次搜索计时不准
+		MoveTable::Get();
+		HeuristicTable::Get();
+	}
+	~Expectimax_AI(void) = default;
+
+	//可能指向自己的置换表，不能拷贝与移动
+	Expectimax_AI(const Expectimax_AI &) = delete;
+	Expectimax_AI &operator=(const Expectimax_AI &) = delete;
+
+	//对每个方向分别搜索，返回各方向期望值与最佳方向
+	SearchResult Search(const BitBoard &bbBoard)
+	{
+		//剪枝后的缓存值与最先写入它的路径有关，自己的表只用本次搜索的结果；共享表之前搜索的结果仍然可用，只是在替换时让位
+		pTable->NewGeneration();
+		u64Nodes = 0;
+
+		SearchResult srRet{ Direction::Enum_End, {}, 0 };
+		double dBest = -1.0;
+		for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+		{
+			BitBoard::MoveResult mrMove = bbBoard.Move((Direction)d);
+			if (!mrMove.bChanged)
+			{
+				continue;
+			}
+
+			//根节点本身就是一层最大节点
+			double dValue = MoveReward(mrMove) + ChanceNode(mrMove.bbBoard, 1.0, cfgSearch.u64MaxDepth - 1);
+			srRet.dMoveValue[d] = dValue;
+			if (srRet.dBest == Direction::Enum_End || dValue > dBest)
+			{
+				dBest = dValue;
+				srRet.dBest = (Direction)d;
+			}
+		}
+
+		srRet.u64Nodes = u64Nodes;
+		return srRet;
+	}
+
+	//只返回最佳方向，没有合法移动时返回Enum_End
+	Direction BestMove(const BitBoard &bbBoard)
+	{
+		return Search(bbBoard).dBest;
+	}
+
+	//静态估值，不做搜索
+	static double Evaluate(const BitBoard &bbBoard) noexcept
+	{
+		return HeuristicTable::Get().Evaluate(bbBoard);
+	}
+};
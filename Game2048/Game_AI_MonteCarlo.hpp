@@ -0,0 +1,268 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <bit>
+
+#include "Game_Board.hpp"
+#include "Game_Random.hpp"
+#include "Thread_Pool.hpp"
+
+/*
+蒙特卡洛模拟（Monte Carlo rollout）:
+
+对每个合法方向，先走这一步，再从得到的局面开始随机下到游戏结束，重复成千上万次，
+选择平均得分最高的方向
+模拟按固定大小分块作为任务提交到工作窃取线程池，每块做完如果还没到时间就为下一个合法方向提交一块，
+各方向轮流推进，时间到时每个方向的模拟次数大致相同；模拟长短不一时空闲线程会去偷其它线程的任务
+每块使用由(种子, 决策序号, 方向, 块号)派生的随机数流，与哪个线程执行无关；
+只按模拟次数限制（不限时）时结果可以逐位复现
+*/
+class MonteCarlo_AI
+{
+public:
+	struct Config
+	{
+		uint64_t u64Threads = 0;//线程数，0代表使用所有核心
+		double dTimeBudget = 0.05;//每次决策的时间预算（秒），0代表不限时
+		uint64_t u64MaxRollouts = 0;//每个方向的模拟次数上限，0代表不限（此时必须限时）
+		uint64_t u64ChunkRollouts = 32;//每个任务连续做的模拟次数
+		uint64_t u64Seed = 0;//主种子
+		double dSpawnWeights_2 = 0.9;//生成2的权重
+		double dSpawnWeights_4 = 0.1;//生成4的权重
+	};
+
+	struct SearchResult
+	{
+		Direction dBest;//最佳方向，没有任何合法移动时为Enum_End
+		double dMeanScore[Direction::Enum_End];//每个方向的平均得分（包括这一步本身），非法方向为0
+		uint64_t u64Rollouts[Direction::Enum_End];//每个方向完成的模拟次数
+		uint64_t u64TotalRollouts;
+	};
+
+private:
+	//每个方向的累计结果，独占缓存行避免多个方向互相干扰
+	struct alignas(64) MoveStats
+	{
+		std::atomic<uint64_t> atScore;//所有模拟得分之和，整数相加与顺序无关
+		std::atomic<uint64_t> atRollouts;
+		std::atomic<uint64_t> atNextChunk;
+	};
+
+	Config cfgSearch;
+	uint64_t u64Spawn4Threshold;
+	uint64_t u64Decision;//决策序号，参与随机数流的派生
+
+	Thread_Pool tpWorkers;
+	MoveStats msMove[Direction::Enum_End];
+
+	//单次决策期间有效
+	BitBoard bbRoot[Direction::Enum_End];//每个方向走完之后的局面
+	uint32_t u32RootScore[Direction::Enum_End];//每个方向这一步本身的得分
+	uint8_t u8LegalMask;//合法方向掩码，第d位为1代表方向d合法
+	std::chrono::steady_clock::time_point tpDeadline;
+
+private:
+	//从刚走完一步（还没生成数字）的局面随机下到结束，返回这期间的得分
+	uint64_t Rollout(BitBoard bbBoard, Rand_Counter &randGen) const noexcept
+	{
+		uint64_t u64Score = 0;
+		while (true)
+		{
+			uint16_t u16EmptyMask = bbBoard.EmptyMask();
+			uint64_t u64Index = BitBoard::SelectBit(u16EmptyMask, randGen.Below(std::popcount(u16EmptyMask)));
+			bbBoard.SetExp(u64Index, randGen.Next() < u64Spawn4Threshold ? 2 : 1);
+
+			//查表得到合法方向，只移动选中的那一个方向
+			uint8_t u8Legal = bbBoard.LegalMoves();
+			if (u8Legal == 0)
+			{
+				return u64Score;
+			}
+
+			Direction dPick = (Direction)BitBoard::SelectBit(u8Legal, randGen.Below(std::popcount(u8Legal)));
+			BitBoard::MoveResult mrPick = bbBoard.Move(dPick);
+			u64Score += mrPick.u32Score;
+			bbBoard = mrPick.bbBoard;
+		}
+	}
+
+	bool OutOfTime(void) const noexcept
+	{
+		return cfgSearch.dTimeBudget > 0.0 && std::chrono::steady_clock::now() >= tpDeadline;
+	}
+
+	//循环意义上的下一个合法方向
+	Direction NextLegal(Direction dMove) const noexcept
+	{
+		for (Direction_Raw i = 1; i <= Direction::Enum_End; ++i)
+		{
+			Direction_Raw d = (dMove + i) % Direction::Enum_End;
+			if (u8LegalMask & (1 << d))
+			{
+				return (Direction)d;
+			}
+		}
+		return dMove;
+	}
+
+	//做一块模拟，如果预算还有剩余就为下一个合法方向提交一块
+	void RunChunk(Direction dMove)
+	{
+		MoveStats &msCur = msMove[dMove];
+
+		//每个方向的第一块不受时间限制，保证时间再紧每个方向也有结果
+		uint64_t u64Chunk = msCur.atNextChunk.fetch_add(1, std::memory_order_relaxed);
+		if (u64Chunk != 0 && OutOfTime())
+		{
+			return;
+		}
+
+		uint64_t u64Beg = u64Chunk * cfgSearch.u64ChunkRollouts;
+		if (cfgSearch.u64MaxRollouts != 0 && u64Beg >= cfgSearch.u64MaxRollouts)
+		{
+			//这个方向已经做满，换一个还没做满的方向继续，全部做满则结束
+			Direction dNext = dMove;
+			for (Direction_Raw i = 0; i < Direction::Enum_End; ++i)
+			{
+				dNext = NextLegal(dNext);
+				if (msMove[dNext].atNextChunk.load(std::memory_order_relaxed) * cfgSearch.u64ChunkRollouts < cfgSearch.u64MaxRollouts)
+				{
+					tpWorkers.Submit([this, dNext](void) -> void
+					{
+						RunChunk(dNext);
+					});
+					break;
+				}
+			}
+			return;
+		}
+		uint64_t u64End = u64Beg + cfgSearch.u64ChunkRollouts;
+		if (cfgSearch.u64MaxRollouts != 0 && u64End > cfgSearch.u64MaxRollouts)
+		{
+			u64End = cfgSearch.u64MaxRollouts;
+		}
+
+		//流编号：决策序号、方向、块号，块号不超过2^24
+		Rand_Counter randGen = Rand_Counter::Stream(cfgSearch.u64Seed, ((u64Decision * Direction::Enum_End + dMove) << 24) | (u64Chunk & 0xFF'FFFF));
+
+		uint64_t u64Score = 0;
+		for (uint64_t i = u64Beg; i < u64End; ++i)
+		{
+			u64Score += Rollout(bbRoot[dMove], randGen);
+		}
+
+		msCur.atScore.fetch_add(u64Score + (u64End - u64Beg) * u32RootScore[dMove], std::memory_order_relaxed);
+		msCur.atRollouts.fetch_add(u64End - u64Beg, std::memory_order_relaxed);
+
+		Direction dNext = NextLegal(dMove);
+		tpWorkers.Submit([this, dNext](void) -> void
+		{
+			RunChunk(dNext);
+		});
+	}
+
+public:
+	MonteCarlo_AI(void) : MonteCarlo_AI(Config{})
+	{}
+	explicit MonteCarlo_AI(const Config &_cfgSearch) :
+		cfgSearch(_cfgSearch),
+		u64Spawn4Threshold(Game2048_Random::ProbToThreshold(_cfgSearch.dSpawnWeights_4 / (_cfgSearch.dSpawnWeights_2 + _cfgSearch.dSpawnWeights_4))),
+		u64Decision(0),
+		tpWorkers(_cfgSearch.u64Threads),
+		msMove{},
+		bbRoot{},
+		u32RootScore{},
+		u8LegalMask(0),
+		tpDeadline()
+	{
+		//既不限时也不限次数则永远不会结束
+		if (cfgSearch.dTimeBudget <= 0.0 && cfgSearch.u64MaxRollouts == 0)
+		{
+			cfgSearch.u64MaxRollouts = 1000;
+		}
+		if (cfgSearch.u64ChunkRollouts == 0)
+		{
+			cfgSearch.u64ChunkRollouts = 1;
+		}
+
+		MoveTable::Get();
+	}
+	~MonteCarlo_AI(void) = default;
+
+	//换一个种子（例如每局开始时），决策序号从头计数
+	void SetSeed(uint64_t u64Seed) noexcept
+	{
+		cfgSearch.u64Seed = u64Seed;
+		u64Decision = 0;
+	}
+
+	SearchResult Search(const BitBoard &bbBoard)
+	{
+		tpDeadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(cfgSearch.dTimeBudget));
+
+		//先确定所有合法方向，任务之间轮流推进需要知道全部方向
+		for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+		{
+			msMove[d].atScore.store(0, std::memory_order_relaxed);
+			msMove[d].atRollouts.store(0, std::memory_order_relaxed);
+			msMove[d].atNextChunk.store(0, std::memory_order_relaxed);
+
+			BitBoard::MoveResult mrMove = bbBoard.Move((Direction)d);
+			bbRoot[d] = mrMove.bbBoard;
+			u32RootScore[d] = mrMove.u32Score;
+		}
+		u8LegalMask = bbBoard.LegalMoves();
+
+		//每个合法方向先提交与线程数相同的任务，之后由任务自己续上
+		uint64_t u64Starts = tpWorkers.GetThreadCount();
+		for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+		{
+			if (!(u8LegalMask & (1 << d)))
+			{
+				continue;
+			}
+
+			for (uint64_t i = 0; i < u64Starts; ++i)
+			{
+				tpWorkers.Submit([this, d](void) -> void
+				{
+					RunChunk((Direction)d);
+				});
+			}
+		}
+		tpWorkers.Wait();
+
+		SearchResult srRet{ Direction::Enum_End, {}, {}, 0 };
+		double dBest = -1.0;
+		for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+		{
+			uint64_t u64Rollouts = msMove[d].atRollouts.load(std::memory_order_relaxed);
+			srRet.u64Rollouts[d] = u64Rollouts;
+			srRet.u64TotalRollouts += u64Rollouts;
+			if (u64Rollouts == 0)
+			{
+				continue;
+			}
+
+			double dMean = (double)msMove[d].atScore.load(std::memory_order_relaxed) / (double)u64Rollouts;
+			srRet.dMeanScore[d] = dMean;
+			if (dMean > dBest)
+			{
+				dBest = dMean;
+				srRet.dBest = (Direction)d;
+			}
+		}
+
+		++u64Decision;
+		return srRet;
+	}
+
+	//只返回最佳方向，没有合法移动时返回Enum_End
+	Direction BestMove(const BitBoard &bbBoard)
+	{
+		return Search(bbBoard).dBest;
+	}
+};
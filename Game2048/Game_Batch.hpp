@@ -0,0 +1,539 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <optional>
+#include <bit>
+#include <mutex>
+
+#include "Game_Engine.hpp"
+#include "Game_AI_Expectimax.hpp"
+#include "Game_AI_MonteCarlo.hpp"
+#include "Game_Replay.hpp"
+#include "Game_BatchMove.hpp"
+#include "Game_NTuple.hpp"
+
+/*
+无界面批量模拟:
+
+不经过Console_Input与终端，直接用Game2048_Engine按指定策略玩N局
+每个工作线程持有自己的随机数生成器与AI实例，按局号领取任务，
+每局的引擎用由(主种子, 局号)派生的随机数流构造，所以结果与线程数、调度顺序无关，可以复现
+各线程的统计结果在最后合并
+指定回放文件时，每局都记录为一条回放，各线程先在本地缓冲，攒够一定大小再加锁写入文件
+（记录之间的顺序取决于调度，每条记录本身与线程数无关）
+*/
+class Batch_Simulation
+{
+public:
+	enum Policy
+	{
+		Random = 0,//在合法方向中均匀随机
+		Greedy,//选择本步得分最高的方向，得分相同则选空格多的
+		Search,//期望最大化搜索
+		MonteCarlo,//蒙特卡洛随机模拟
+		NTuple,//选择 本步得分 + N元组网络对移动后局面的估值 最大的方向
+	};
+
+	struct Config
+	{
+		uint64_t u64Games = 1000;//总局数
+		Policy enPolicy = Random;//策略
+		uint64_t u64Threads = 0;//线程数，0代表使用所有核心
+		uint64_t u64Seed = 0;//主种子
+		uint64_t u64SearchDepth = 2;//Search策略的搜索深度
+		uint64_t u64Rollouts = 100;//MonteCarlo策略每个方向的模拟次数
+		bool bSharedTable = false;//Search策略的所有线程共用一张置换表（省内存，但结果取决于线程调度，不再可复现）
+		const NTuple_Network *pNetwork = nullptr;//NTuple策略的网络；Search策略指定了网络时用它给叶节点估值
+		double dSpawnWeights_2 = 0.9;//生成2的权重
+		double dSpawnWeights_4 = 0.1;//生成4的权重
+		const char *pRecordPath = NULL;//回放文件，为NULL时不记录
+	};
+
+	struct Result
+	{
+		uint64_t u64Games = 0;//完成的局数
+		uint64_t u64Moves = 0;//总移动次数
+		uint64_t u64TotalScore = 0;//总得分
+		uint64_t u64MaxScore = 0;//单局最高得分
+		uint64_t u64Wins = 0;//达到2048的局数
+		uint64_t u64PolicyErrors = 0;//策略选了不合法方向而提前结束的局数，正常应为0
+		uint64_t u64MaxTileCount[BitBoard::u8MaxExp + 1] = {};//按每局最大格子指数统计的局数
+
+		void Merge(const Result &_Right) noexcept
+		{
+			u64Games += _Right.u64Games;
+			u64Moves += _Right.u64Moves;
+			u64TotalScore += _Right.u64TotalScore;
+			u64MaxScore = _Right.u64MaxScore > u64MaxScore ? _Right.u64MaxScore : u64MaxScore;
+			u64Wins += _Right.u64Wins;
+			u64PolicyErrors += _Right.u64PolicyErrors;
+			for (uint64_t i = 0; i <= BitBoard::u8MaxExp; ++i)
+			{
+				u64MaxTileCount[i] += _Right.u64MaxTileCount[i];
+			}
+		}
+	};
+
+private:
+	constexpr const static inline uint8_t u8WinExp = 11;//2048的指数
+	constexpr const static inline size_t szRecordFlushBytes = 1 << 20;//线程本地回放缓冲超过此大小就写入文件
+
+	//回放文件与保护它的锁
+	struct RecordSink
+	{
+		FILE *fp = NULL;
+		std::mutex mtx;
+	};
+
+	//每个线程的模拟状态
+	class Worker
+	{
+	private:
+		const Config &cfgBatch;
+
+		Rand_Counter randPolicy;//Random策略使用的随机数生成器，与引擎自己的生成器分开
+		std::optional<Expectimax_AI> optSearch;//只有Search策略才构造，缓存表较大
+		std::optional<MonteCarlo_AI> optRollout;//只有MonteCarlo策略才构造
+
+		RecordSink &rsRecord;
+		Replay_Recorder rrLocal;//本线程的回放缓冲
+
+		Result resLocal;
+
+	private:
+		//按策略选择方向，u8Legal为引擎维护的合法方向掩码，没有合法方向时返回Enum_End
+		Direction ChooseMove(const BitBoard &bbBoard, uint8_t u8Legal)
+		{
+			if (cfgBatch.enPolicy == Search)
+			{
+				return optSearch->BestMove(bbBoard);
+			}
+			if (cfgBatch.enPolicy == MonteCarlo)
+			{
+				return optRollout->BestMove(bbBoard);
+			}
+			if (cfgBatch.enPolicy == NTuple)//所有线程只读同一份映射的权重
+			{
+				return cfgBatch.pNetwork->BestMove(bbBoard).dBest;
+			}
+
+			if (u8Legal == 0)
+			{
+				return Direction::Enum_End;
+			}
+
+			if (cfgBatch.enPolicy == Random)//只需要掩码，不用真的移动
+			{
+				return (Direction)BitBoard::SelectBit(u8Legal, randPolicy.Below(std::popcount(u8Legal)));
+			}
+
+			//4个方向一次批量移动
+			constexpr const static Direction dAll[Direction::Enum_End] = { Up, Dn, Lt, Rt };
+			const BitBoard bbSrc[Direction::Enum_End] = { bbBoard, bbBoard, bbBoard, bbBoard };
+			BitBoard bbMoved[Direction::Enum_End];
+			uint32_t u32Score[Direction::Enum_End];
+			Batch_Move::Move(bbSrc, dAll, bbMoved, u32Score, Direction::Enum_End);
+
+			Direction dBest = Direction::Enum_End;
+			uint64_t u64BestScore = 0;
+			uint64_t u64BestEmpty = 0;
+			for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+			{
+				if (!(u8Legal & (1 << d)))
+				{
+					continue;
+				}
+
+				uint64_t u64Empty = bbMoved[d].CountEmpty();
+				if (dBest == Direction::Enum_End ||
+					u32Score[d] > u64BestScore ||
+					(u32Score[d] == u64BestScore && u64Empty > u64BestEmpty))
+				{
+					dBest = (Direction)d;
+					u64BestScore = u32Score[d];
+					u64BestEmpty = u64Empty;
+				}
+			}
+
+			return dBest;
+		}
+
+		void PlayOne(uint64_t u64GameIndex)
+		{
+			//每局使用主种子派生的独立流：偶数流给引擎，奇数流给策略，结果只取决于主种子与局号
+			randPolicy = Rand_Counter::Stream(cfgBatch.u64Seed, u64GameIndex * 2 + 1);
+			if (optRollout.has_value())
+			{
+				optRollout->SetSeed(Game2048_Random::StreamKey(cfgBatch.u64Seed, u64GameIndex * 2 + 1));
+			}
+
+			Game2048_Engine<> engGame{ Rand_Counter::Stream(cfgBatch.u64Seed, u64GameIndex * 2), cfgBatch.dSpawnWeights_2, cfgBatch.dSpawnWeights_4 };
+			bool bRecord = rsRecord.fp != NULL;
+			if (bRecord)
+			{
+				rrLocal.Begin(4, 4, cfgBatch.u64Seed, u64GameIndex * 2, 0, cfgBatch.dSpawnWeights_2, cfgBatch.dSpawnWeights_4);
+			}
+			engGame.Reset();
+
+			uint64_t u64Moves = 0;
+			while (engGame.GetStatus() != LostGame)
+			{
+				if (engGame.GetStatus() == WinGame)//达到2048后继续玩到底
+				{
+					engGame.ContinueAfterWin();
+					continue;
+				}
+
+				Direction dMove = ChooseMove(engGame.GetBoard(), engGame.LegalMoves());
+				if (dMove == Direction::Enum_End)//无路可走，本局结束
+				{
+					break;
+				}
+
+				if (!engGame.ProcessMove(dMove))//策略出错选了不改变棋盘的方向，继续下去会死循环，结束本局并计数
+				{
+					++resLocal.u64PolicyErrors;
+					break;
+				}
+				++u64Moves;
+				if (bRecord)
+				{
+					rrLocal.Record(dMove);//走到这里的每一步都改变了棋盘
+				}
+			}
+
+			if (bRecord)
+			{
+				rrLocal.End(engGame.GetScore());
+				if (rrLocal.PendingBytes() >= szRecordFlushBytes)
+				{
+					FlushRecord();
+				}
+			}
+
+			const BitBoard &bbBoard = engGame.GetBoard();
+			uint64_t u64Score = engGame.GetScore();
+			uint8_t u8MaxExp = bbBoard.MaxExp();
+
+			++resLocal.u64Games;
+			resLocal.u64Moves += u64Moves;
+			resLocal.u64TotalScore += u64Score;
+			resLocal.u64MaxScore = u64Score > resLocal.u64MaxScore ? u64Score : resLocal.u64MaxScore;
+			resLocal.u64Wins += u8MaxExp >= u8WinExp;
+			++resLocal.u64MaxTileCount[u8MaxExp];
+		}
+
+		static Expectimax_AI::Config MakeSearchConfig(const Config &cfgBatch, Transposition_Table *pSharedTable)
+		{
+			Expectimax_AI::Config cfgSearch{};
+			cfgSearch.pSharedTable = pSharedTable;
+			cfgSearch.pEvaluator = cfgBatch.pNetwork;
+			cfgSearch.u64MaxDepth = cfgBatch.u64SearchDepth;
+			cfgSearch.dSpawnWeights_2 = cfgBatch.dSpawnWeights_2;
+			cfgSearch.dSpawnWeights_4 = cfgBatch.dSpawnWeights_4;
+			return cfgSearch;
+		}
+
+		//批量模拟已经在所有核心上并行，每局的模拟只用一个线程，按次数限制（不限时）保证结果可复现
+		static MonteCarlo_AI::Config MakeRolloutConfig(const Config &cfgBatch)
+		{
+			MonteCarlo_AI::Config cfgRollout{};
+			cfgRollout.u64Threads = 1;
+			cfgRollout.dTimeBudget = 0.0;
+			cfgRollout.u64MaxRollouts = cfgBatch.u64Rollouts;
+			cfgRollout.dSpawnWeights_2 = cfgBatch.dSpawnWeights_2;
+			cfgRollout.dSpawnWeights_4 = cfgBatch.dSpawnWeights_4;
+			return cfgRollout;
+		}
+
+	public:
+		Worker(const Config &_cfgBatch, RecordSink &_rsRecord, Transposition_Table *pSharedTable) :
+			cfgBatch(_cfgBatch),
+			randPolicy(),
+			optSearch(),
+			optRollout(),
+			rsRecord(_rsRecord),
+			rrLocal(),
+			resLocal()
+		{
+			if (cfgBatch.enPolicy == Search)
+			{
+				optSearch.emplace(MakeSearchConfig(cfgBatch, pSharedTable));
+			}
+			if (cfgBatch.enPolicy == MonteCarlo)
+			{
+				optRollout.emplace(MakeRolloutConfig(cfgBatch));
+			}
+		}
+		~Worker(void) = default;
+
+		//不断领取局号直到全部领完
+		void Run(std::atomic<uint64_t> &atNextGame)
+		{
+			while (true)
+			{
+				uint64_t u64GameIndex = atNextGame.fetch_add(1, std::memory_order_relaxed);
+				if (u64GameIndex >= cfgBatch.u64Games)
+				{
+					break;
+				}
+				PlayOne(u64GameIndex);
+			}
+
+			FlushRecord();
+		}
+
+		void FlushRecord(void)
+		{
+			if (rsRecord.fp == NULL)
+			{
+				return;
+			}
+
+			std::lock_guard<std::mutex> lgRecord{ rsRecord.mtx };
+			rrLocal.WriteTo(rsRecord.fp);
+		}
+
+		const Result &GetResult(void) const noexcept
+		{
+			return resLocal;
+		}
+	};
+
+public:
+	//回放文件打不开时不玩任何一局，返回false
+	static bool Run(const Config &cfgBatch, Result &resTotal)
+	{
+		uint64_t u64Threads = cfgBatch.u64Threads;
+		if (u64Threads == 0)
+		{
+			u64Threads = std::thread::hardware_concurrency();
+			u64Threads = u64Threads == 0 ? 1 : u64Threads;
+		}
+
+		std::atomic<uint64_t> atNextGame{ 0 };
+
+		RecordSink rsRecord{};
+		if (cfgBatch.pRecordPath != NULL)
+		{
+			rsRecord.fp = fopen(cfgBatch.pRecordPath, "ab");
+			if (rsRecord.fp == NULL)
+			{
+				fprintf(stderr, "Error: cannot open record file %s\n", cfgBatch.pRecordPath);
+				return false;
+			}
+		}
+
+		//共用的置换表与各线程自己的表总大小相同
+		std::optional<Transposition_Table> optSharedTable;
+		if (cfgBatch.enPolicy == Search && cfgBatch.bSharedTable)
+		{
+			optSharedTable.emplace(Expectimax_AI::Config{}.u64CacheBits + std::bit_width(u64Threads - 1));
+		}
+		Transposition_Table *pSharedTable = optSharedTable.has_value() ? &*optSharedTable : nullptr;
+
+		//每个线程在自己的栈上构造Worker，避免状态挤在同一缓存行
+		std::vector<Result> vecResult(u64Threads);
+		std::vector<std::thread> vecThread;
+		vecThread.reserve(u64Threads);
+		for (uint64_t i = 0; i < u64Threads; ++i)
+		{
+			vecThread.emplace_back([&, i](void) -> void
+			{
+				Worker wkThread{ cfgBatch, rsRecord, pSharedTable };
+				wkThread.Run(atNextGame);
+				vecResult[i] = wkThread.GetResult();
+			});
+		}
+
+		resTotal = Result{};
+		for (uint64_t i = 0; i < u64Threads; ++i)
+		{
+			vecThread[i].join();
+			resTotal.Merge(vecResult[i]);
+		}
+
+		if (rsRecord.fp != NULL)
+		{
+			fclose(rsRecord.fp);
+		}
+
+		return true;
+	}
+
+	//以key=value形式输出，方便脚本解析
+	static void PrintResult(const Config &cfgBatch, const Result &resTotal, double dSeconds)
+	{
+		constexpr const static char *pPolicyName[] = { "random", "greedy", "search", "montecarlo", "ntuple" };
+
+		printf("policy=%s\n", pPolicyName[cfgBatch.enPolicy]);
+		printf("seed=%llu\n", (unsigned long long)cfgBatch.u64Seed);
+		printf("kernel=%s\n", Batch_Move::KernelName(Batch_Move::GetKernel()));
+		printf("games=%llu\n", (unsigned long long)resTotal.u64Games);
+		printf("moves=%llu\n", (unsigned long long)resTotal.u64Moves);
+		printf("score_total=%llu\n", (unsigned long long)resTotal.u64TotalScore);
+		printf("score_max=%llu\n", (unsigned long long)resTotal.u64MaxScore);
+		printf("score_mean=%.2f\n", resTotal.u64Games == 0 ? 0.0 : (double)resTotal.u64TotalScore / (double)resTotal.u64Games);
+		printf("wins=%llu\n", (unsigned long long)resTotal.u64Wins);
+		printf("policy_errors=%llu\n", (unsigned long long)resTotal.u64PolicyErrors);
+		for (uint64_t i = 1; i <= BitBoard::u8MaxExp; ++i)
+		{
+			if (resTotal.u64MaxTileCount[i] != 0)
+			{
+				printf("max_tile_%llu=%llu\n", (unsigned long long)BitBoard::ExpToValue((uint8_t)i), (unsigned long long)resTotal.u64MaxTileCount[i]);
+			}
+		}
+		printf("seconds=%.3f\n", dSeconds);
+		printf("games_per_second=%.1f\n", dSeconds > 0.0 ? (double)resTotal.u64Games / dSeconds : 0.0);
+	}
+
+	//命令行入口：game2048 --batch <games> [--policy random|greedy|search|montecarlo|ntuple] [--threads N] [--seed S] [--depth D] [--rollouts R] [--kernel auto|scalar|avx2] [--shared-table 0|1] [--weights FILE] [--record FILE]
+	static int Main(int argc, char *argv[])
+	{
+		auto Usage = [&](void) -> int
+		{
+			fprintf(stderr, "Usage: %s --batch <games> [--policy random|greedy|search|montecarlo|ntuple] [--threads N] [--seed S] [--depth D] [--rollouts R] [--kernel auto|scalar|avx2] [--shared-table 0|1] [--weights FILE] [--record FILE]\n", argv[0]);
+			return 1;
+		};
+
+		if (argc < 3)
+		{
+			return Usage();
+		}
+
+		Config cfgBatch{};
+		cfgBatch.u64Games = strtoull(argv[2], NULL, 10);
+		cfgBatch.u64Seed = std::random_device{}();
+		NTuple_Network ntNetwork{};
+
+		for (int i = 3; i < argc; i += 2)
+		{
+			if (i + 1 >= argc)
+			{
+				return Usage();
+			}
+
+			const char *pArg = argv[i];
+			const char *pValue = argv[i + 1];
+			if (strcmp(pArg, "--policy") == 0)
+			{
+				if (strcmp(pValue, "random") == 0)
+				{
+					cfgBatch.enPolicy = Random;
+				}
+				else if (strcmp(pValue, "greedy") == 0)
+				{
+					cfgBatch.enPolicy = Greedy;
+				}
+				else if (strcmp(pValue, "search") == 0)
+				{
+					cfgBatch.enPolicy = Search;
+				}
+				else if (strcmp(pValue, "montecarlo") == 0)
+				{
+					cfgBatch.enPolicy = MonteCarlo;
+				}
+				else if (strcmp(pValue, "ntuple") == 0)
+				{
+					cfgBatch.enPolicy = NTuple;
+				}
+				else
+				{
+					return Usage();
+				}
+			}
+			else if (strcmp(pArg, "--threads") == 0)
+			{
+				cfgBatch.u64Threads = strtoull(pValue, NULL, 10);
+			}
+			else if (strcmp(pArg, "--seed") == 0)
+			{
+				cfgBatch.u64Seed = strtoull(pValue, NULL, 10);
+			}
+			else if (strcmp(pArg, "--rollouts") == 0)
+			{
+				cfgBatch.u64Rollouts = strtoull(pValue, NULL, 10);
+				if (cfgBatch.u64Rollouts == 0)
+				{
+					return Usage();
+				}
+			}
+			else if (strcmp(pArg, "--depth") == 0)
+			{
+				cfgBatch.u64SearchDepth = strtoull(pValue, NULL, 10);
+				if (cfgBatch.u64SearchDepth == 0)
+				{
+					return Usage();
+				}
+			}
+			else if (strcmp(pArg, "--kernel") == 0)//批量移动的实现，默认按CPU自动选择
+			{
+				Batch_Move::Kernel enKernel = Batch_Move::Detect();
+				if (strcmp(pValue, "scalar") == 0)
+				{
+					enKernel = Batch_Move::Scalar;
+				}
+				else if (strcmp(pValue, "avx2") == 0)
+				{
+					enKernel = Batch_Move::AVX2;
+				}
+				else if (strcmp(pValue, "auto") != 0)
+				{
+					return Usage();
+				}
+
+				if (!Batch_Move::SetKernel(enKernel))
+				{
+					fprintf(stderr, "Error: kernel %s is not supported on this CPU\n", pValue);
+					return 1;
+				}
+			}
+			else if (strcmp(pArg, "--shared-table") == 0)
+			{
+				cfgBatch.bSharedTable = strtoull(pValue, NULL, 10) != 0;
+			}
+			else if (strcmp(pArg, "--record") == 0)
+			{
+				cfgBatch.pRecordPath = pValue;
+			}
+			else if (strcmp(pArg, "--weights") == 0)//N元组网络存档，只读映射
+			{
+				if (!ntNetwork.Load(pValue, true))
+				{
+					fprintf(stderr, "Error: cannot load weights %s\n", pValue);
+					return 1;
+				}
+				cfgBatch.pNetwork = &ntNetwork;
+			}
+			else
+			{
+				return Usage();
+			}
+		}
+
+		if (cfgBatch.enPolicy == NTuple && cfgBatch.pNetwork == nullptr)
+		{
+			return Usage();
+		}
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		Result resTotal{};
+		if (!Run(cfgBatch, resTotal))
+		{
+			return 1;
+		}
+		auto tpEnd = std::chrono::steady_clock::now();
+
+		PrintResult(cfgBatch, resTotal, std::chrono::duration<double>(tpEnd - tpBeg).count());
+		return resTotal.u64PolicyErrors == 0 ? 0 : 1;
+	}
+};
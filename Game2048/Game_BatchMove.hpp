@@ -0,0 +1,212 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "Game_Board.hpp"
+#include "Game_MoveTable.hpp"
+
+//x86-64上编译AVX2版本（只对这几个函数启用指令集），运行时按CPU是否支持决定是否使用
+#if defined(__x86_64__) || defined(_M_X64)
+#define GAME2048_BATCH_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define GAME2048_TARGET_AVX2
+#else
+#define GAME2048_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+/*
+多棋盘批量移动:
+
+一次把最多64个4*4位棋盘各自按自己的方向移动，返回移动了的棋盘位掩码，每个棋盘的得分写入数组
+AVX2版本每次处理4个棋盘：竖直方向的棋盘先转置，16行一起从行移动表里gather出移动后的行与得分，
+再拼回棋盘、把竖直方向的转置回来；向左与向右的表在MoveTable里连续存放，每个棋盘只是下标偏移不同
+CPU不支持AVX2（或不是x86-64）时逐个调用BitBoard::Move，两种实现的结果逐位相同
+SSE4没有gather，查表部分与标量版本一样只能逐个读取，所以不单独提供
+*/
+class Batch_Move
+{
+public:
+	constexpr const static inline size_t szMaxBoards = 64;//一次调用最多的棋盘数（移动掩码的位数）
+
+	enum Kernel : uint8_t
+	{
+		Scalar = 0,
+		AVX2,
+		Kernel_End,
+	};
+
+private:
+	static_assert(sizeof(BitBoard) == sizeof(uint64_t), "BitBoard must be a plain 64-bit word");
+	static_assert(sizeof(RowMoveEntry) == 12 && offsetof(RowMoveEntry, u16Row) == 0 && offsetof(RowMoveEntry, u32Score) == 4,
+		"the AVX2 kernel gathers RowMoveEntry as three 32-bit words");
+
+	static std::atomic<Kernel> &CurrentKernel(void) noexcept
+	{
+		static std::atomic<Kernel> atKernel{ Detect() };
+		return atKernel;
+	}
+
+	static uint64_t MoveScalar(const BitBoard *pIn, const Direction *pDir, BitBoard *pOut, uint32_t *pScore, size_t szCount) noexcept
+	{
+		uint64_t u64Moved = 0;
+		for (size_t i = 0; i < szCount; ++i)
+		{
+			BitBoard::MoveResult mrMove = pIn[i].Move(pDir[i]);
+			pOut[i] = mrMove.bbBoard;
+			pScore[i] = mrMove.u32Score;
+			u64Moved |= (uint64_t)mrMove.bChanged << i;
+		}
+		return u64Moved;
+	}
+
+#ifdef GAME2048_BATCH_AVX2
+	//4个棋盘各自转置，与BitBoard::Transpose相同
+	GAME2048_TARGET_AVX2 static __m256i Transpose4(__m256i x) noexcept
+	{
+		__m256i t = _mm256_and_si256(_mm256_xor_si256(x, _mm256_srli_epi64(x, 12)), _mm256_set1_epi64x(0x0000'F0F0'0000'F0F0));
+		x = _mm256_xor_si256(x, _mm256_xor_si256(t, _mm256_slli_epi64(t, 12)));
+		t = _mm256_and_si256(_mm256_xor_si256(x, _mm256_srli_epi64(x, 24)), _mm256_set1_epi64x(0x0000'0000'FF00'FF00));
+		x = _mm256_xor_si256(x, _mm256_xor_si256(t, _mm256_slli_epi64(t, 24)));
+		return x;
+	}
+
+	GAME2048_TARGET_AVX2 static uint64_t Move4(const BitBoard *pIn, const Direction *pDir, BitBoard *pOut, uint32_t *pScore, const int *pTable) noexcept
+	{
+		//每个棋盘：竖直方向为全1（需要转置），向右（下）的表从szRowCount开始
+		auto Vertical = [&](size_t i) -> long long
+		{
+			return (pDir[i] == Up || pDir[i] == Dn) ? -1 : 0;
+		};
+		auto Offset = [&](size_t i) -> int
+		{
+			return (pDir[i] == Dn || pDir[i] == Rt) ? (int)MoveTable::szRowCount : 0;
+		};
+
+		__m256i vSrc = _mm256_loadu_si256((const __m256i *)pIn);
+		__m256i vVert = _mm256_setr_epi64x(Vertical(0), Vertical(1), Vertical(2), Vertical(3));
+		__m256i vBoard = _mm256_blendv_epi8(vSrc, Transpose4(vSrc), vVert);
+
+		//每个棋盘4行展开为4个32位下标：A为棋盘0、1，B为棋盘2、3；表项12字节，即3个32位字
+		int iOff0 = Offset(0), iOff1 = Offset(1), iOff2 = Offset(2), iOff3 = Offset(3);
+		__m256i vIdxA = _mm256_add_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(vBoard)), _mm256_setr_epi32(iOff0, iOff0, iOff0, iOff0, iOff1, iOff1, iOff1, iOff1));
+		__m256i vIdxB = _mm256_add_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(vBoard, 1)), _mm256_setr_epi32(iOff2, iOff2, iOff2, iOff2, iOff3, iOff3, iOff3, iOff3));
+		vIdxA = _mm256_add_epi32(vIdxA, _mm256_slli_epi32(vIdxA, 1));
+		vIdxB = _mm256_add_epi32(vIdxB, _mm256_slli_epi32(vIdxB, 1));
+
+		//第0个字的低16位为移动后的行，第1个字为得分
+		__m256i vLow16 = _mm256_set1_epi32(0xFFFF);
+		__m256i vRowA = _mm256_and_si256(_mm256_i32gather_epi32(pTable, vIdxA, 4), vLow16);
+		__m256i vRowB = _mm256_and_si256(_mm256_i32gather_epi32(pTable, vIdxB, 4), vLow16);
+		__m256i vScoreA = _mm256_i32gather_epi32(pTable + 1, vIdxA, 4);
+		__m256i vScoreB = _mm256_i32gather_epi32(pTable + 1, vIdxB, 4);
+
+		//打包后按128位分组交错为棋盘0、2、1、3，再换回顺序
+		__m256i vRes = _mm256_permute4x64_epi64(_mm256_packus_epi32(vRowA, vRowB), _MM_SHUFFLE(3, 1, 2, 0));
+		vRes = _mm256_blendv_epi8(vRes, Transpose4(vRes), vVert);
+		_mm256_storeu_si256((__m256i *)pOut, vRes);
+
+		//两次水平相加得到每个棋盘4行得分之和，顺序同样是0、2 | 1、3
+		__m256i vSum = _mm256_hadd_epi32(vScoreA, vScoreB);
+		vSum = _mm256_hadd_epi32(vSum, vSum);
+		vSum = _mm256_permutevar8x32_epi32(vSum, _mm256_setr_epi32(0, 4, 1, 5, 0, 4, 1, 5));
+		_mm_storeu_si128((__m128i *)pScore, _mm256_castsi256_si128(vSum));
+
+		int iSame = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(vRes, vSrc)));
+		return (uint64_t)(~iSame & 0xF);
+	}
+
+	static uint64_t MoveAVX2(const BitBoard *pIn, const Direction *pDir, BitBoard *pOut, uint32_t *pScore, size_t szCount) noexcept
+	{
+		const int *pTable = (const int *)MoveTable::Get().Data();
+
+		uint64_t u64Moved = 0;
+		size_t i = 0;
+		for (; i + 4 <= szCount; i += 4)
+		{
+			u64Moved |= Move4(pIn + i, pDir + i, pOut + i, pScore + i, pTable) << i;
+		}
+		//不足4个的尾部
+		return u64Moved | (MoveScalar(pIn + i, pDir + i, pOut + i, pScore + i, szCount - i) << i);
+	}
+#endif
+
+public:
+	//当前CPU可用的最快实现
+	static Kernel Detect(void) noexcept
+	{
+#ifdef GAME2048_BATCH_AVX2
+#ifdef _MSC_VER
+		int iInfo[4];
+		__cpuid(iInfo, 0);
+		if (iInfo[0] < 7)
+		{
+			return Scalar;
+		}
+		__cpuid(iInfo, 1);
+		bool bOSXSave = (iInfo[2] & (1 << 27)) != 0;
+		bool bAVX = (iInfo[2] & (1 << 28)) != 0;
+		if (!bOSXSave || !bAVX || (_xgetbv(0) & 0x6) != 0x6)//操作系统需要保存YMM寄存器
+		{
+			return Scalar;
+		}
+		__cpuidex(iInfo, 7, 0);
+		return (iInfo[1] & (1 << 5)) != 0 ? AVX2 : Scalar;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? AVX2 : Scalar;
+#endif
+#else
+		return Scalar;
+#endif
+	}
+
+	static Kernel GetKernel(void) noexcept
+	{
+		return CurrentKernel().load(std::memory_order_relaxed);
+	}
+
+	//强制使用某个实现（例如对比性能），CPU不支持的实现返回false且不生效
+	static bool SetKernel(Kernel enKernel) noexcept
+	{
+		if (enKernel >= Kernel_End || (enKernel == AVX2 && Detect() != AVX2))
+		{
+			return false;
+		}
+		CurrentKernel().store(enKernel, std::memory_order_relaxed);
+		return true;
+	}
+
+	static const char *KernelName(Kernel enKernel) noexcept
+	{
+		return enKernel == AVX2 ? "avx2" : "scalar";
+	}
+
+	//第i个棋盘按pDir[i]移动，结果写入pOut[i]与pScore[i]；返回值第i位为1代表第i个棋盘发生了变化
+	//szCount不超过szMaxBoards，pOut可以与pIn相同
+	static uint64_t Move(const BitBoard *pIn, const Direction *pDir, BitBoard *pOut, uint32_t *pScore, size_t szCount) noexcept
+	{
+#ifdef GAME2048_BATCH_AVX2
+		if (GetKernel() == AVX2)
+		{
+			return MoveAVX2(pIn, pDir, pOut, pScore, szCount);
+		}
+#endif
+		return MoveScalar(pIn, pDir, pOut, pScore, szCount);
+	}
+
+	//所有棋盘按同一个方向移动
+	static uint64_t Move(const BitBoard *pIn, Direction dMove, BitBoard *pOut, uint32_t *pScore, size_t szCount) noexcept
+	{
+		Direction dArr[szMaxBoards];
+		for (size_t i = 0; i < szCount; ++i)
+		{
+			dArr[i] = dMove;
+		}
+		return Move(pIn, dArr, pOut, pScore, szCount);
+	}
+};
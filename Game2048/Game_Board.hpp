@@ -0,0 +1,891 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <bit>
+#include <type_traits>
+
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define GAME2048_HAS_BMI2 1
+#endif
+
+#include "Game_MoveTable.hpp"
+
+//移动方向
+using Direction_Raw = uint8_t;
+enum Direction : Direction_Raw
+{
+	Up = 0,
+	Dn,
+	Lt,
+	Rt,
+	Enum_End,
+};
+
+//整盘移动的结果，所有棋盘存储方式共用
+template<typename Board>
+struct Board_MoveResult
+{
+	Board bbBoard;//移动后的棋盘
+	uint32_t u32Score;//本次移动合并得分
+	uint16_t u16MergeMask;//本次移动合并产生的指数集合
+	uint8_t u8Merges;//本次移动合并次数
+	bool bChanged;//是否发生了移动或合并
+};
+
+/*
+4*4位棋盘:
+
+每个格子只可能是0或2的幂，所以只存指数（0代表空格），每格4bit，16格刚好64bit
+格子(X,Y)位于第(Y * 4 + X)个半字节，也就是说每行是连续的16bit，行内X越小位越低
+指数最大为15（32768），对于2048游戏来说足够了
+*/
+class BitBoard
+{
+public:
+	using Row = uint16_t;//一行（或一列）4个格子的打包形式
+	using Mask = uint16_t;//每格一位的掩码
+	using MoveResult = Board_MoveResult<BitBoard>;
+
+	constexpr const static inline uint64_t u64Width = 4;
+	constexpr const static inline uint64_t u64Height = 4;
+	constexpr const static inline uint64_t u64TotalSize = u64Width * u64Height;
+
+	constexpr const static inline uint8_t u8MaxExp = 15;//半字节能表示的最大指数
+	constexpr const static inline Mask mskFull = 0xFFFF;//所有格子
+
+private:
+	uint64_t u64Board;
+
+private:
+	constexpr static uint64_t NibbleShift(uint64_t X, uint64_t Y) noexcept
+	{
+		return (Y * u64Width + X) * 4;
+	}
+
+public:
+	//每个半字节为0则对应半字节的最低位为1，否则为0
+	constexpr static uint64_t ZeroNibbleMask(uint64_t u64Value) noexcept
+	{
+		uint64_t u64Inv = ~u64Value;
+		return u64Inv & (u64Inv >> 1) & (u64Inv >> 2) & (u64Inv >> 3) & 0x1111'1111'1111'1111;
+	}
+
+	//把每个半字节最低位上的16个位收拢成16bit
+	constexpr static uint16_t CompressNibbleBits(uint64_t z) noexcept
+	{
+#ifdef GAME2048_HAS_BMI2
+		if (!std::is_constant_evaluated())
+		{
+			return (uint16_t)_pext_u64(z, 0x1111'1111'1111'1111);
+		}
+#endif
+		//没有PEXT时逐级把间隔的位收拢到一起
+		z = (z | (z >> 3)) & 0x0303'0303'0303'0303;
+		z = (z | (z >> 6)) & 0x000F'000F'000F'000F;
+		z = (z | (z >> 12)) & 0x0000'00FF'0000'00FF;
+		z = (z | (z >> 24)) & 0x0000'0000'0000'FFFF;
+		return (uint16_t)z;
+	}
+
+public:
+	constexpr BitBoard(void) noexcept : u64Board(0)
+	{}
+	constexpr explicit BitBoard(uint64_t _u64Board) noexcept : u64Board(_u64Board)
+	{}
+	~BitBoard(void) = default;
+
+	BitBoard(const BitBoard &) = default;
+	BitBoard &operator=(const BitBoard &) = default;
+
+	constexpr bool operator==(const BitBoard &_Right) const noexcept
+	{
+		return u64Board == _Right.u64Board;
+	}
+
+	constexpr bool operator!=(const BitBoard &_Right) const noexcept
+	{
+		return u64Board != _Right.u64Board;
+	}
+
+	//====================原始数据====================
+	constexpr uint64_t GetRaw(void) const noexcept
+	{
+		return u64Board;
+	}
+
+	constexpr void SetRaw(uint64_t _u64Board) noexcept
+	{
+		u64Board = _u64Board;
+	}
+
+	//====================单个格子====================
+	constexpr uint8_t GetExp(uint64_t X, uint64_t Y) const noexcept
+	{
+		return (u64Board >> NibbleShift(X, Y)) & 0xF;
+	}
+
+	constexpr void SetExp(uint64_t X, uint64_t Y, uint8_t u8Exp) noexcept
+	{
+		uint64_t u64Shift = NibbleShift(X, Y);
+		u64Board = (u64Board & ~((uint64_t)0xF << u64Shift)) | ((uint64_t)(u8Exp & 0xF) << u64Shift);
+	}
+
+	//按一维下标访问，下标 = Y * 4 + X
+	constexpr uint8_t GetExp(uint64_t u64Index) const noexcept
+	{
+		return (u64Board >> (u64Index * 4)) & 0xF;
+	}
+
+	constexpr void SetExp(uint64_t u64Index, uint8_t u8Exp) noexcept
+	{
+		uint64_t u64Shift = u64Index * 4;
+		u64Board = (u64Board & ~((uint64_t)0xF << u64Shift)) | ((uint64_t)(u8Exp & 0xF) << u64Shift);
+	}
+
+	//====================行列====================
+	constexpr Row GetRow(uint64_t Y) const noexcept
+	{
+		return (Row)(u64Board >> (Y * 16));
+	}
+
+	constexpr void SetRow(uint64_t Y, Row rowValue) noexcept
+	{
+		uint64_t u64Shift = Y * 16;
+		u64Board = (u64Board & ~((uint64_t)0xFFFF << u64Shift)) | ((uint64_t)rowValue << u64Shift);
+	}
+
+	//列也按行的格式打包：Y越小位越低
+	constexpr Row GetCol(uint64_t X) const noexcept
+	{
+		uint64_t u64Col = (u64Board >> (X * 4)) & 0x000F'000F'000F'000F;
+		return (Row)(u64Col | (u64Col >> 12) | (u64Col >> 24) | (u64Col >> 36));
+	}
+
+	constexpr void SetCol(uint64_t X, Row rowValue) noexcept
+	{
+		uint64_t u64Col = rowValue;
+		u64Col = (u64Col | (u64Col << 12) | (u64Col << 24) | (u64Col << 36)) & 0x000F'000F'000F'000F;
+		uint64_t u64Shift = X * 4;
+		u64Board = (u64Board & ~(0x000F'000F'000F'000F << u64Shift)) | (u64Col << u64Shift);
+	}
+
+	//转置（行变列），每次交换对角线两侧的块，先2*2块内的格子，再交换2*2块
+	constexpr BitBoard Transpose(void) const noexcept
+	{
+		uint64_t x = u64Board;
+		uint64_t t = (x ^ (x >> 12)) & 0x0000'F0F0'0000'F0F0;
+		x ^= t ^ (t << 12);
+		t = (x ^ (x >> 24)) & 0x0000'0000'FF00'FF00;
+		x ^= t ^ (t << 24);
+		return BitBoard{ x };
+	}
+
+	//====================统计====================
+	constexpr uint64_t CountEmpty(void) const noexcept
+	{
+		return std::popcount(ZeroNibbleMask(u64Board));
+	}
+
+	//空格位掩码：第i位为1代表第i个格子（下标 = Y * 4 + X）为空
+	constexpr Mask EmptyMask(void) const noexcept
+	{
+		return CompressNibbleBits(ZeroNibbleMask(u64Board));
+	}
+
+	//返回掩码中第k个（从0开始）为1的位的位置，k必须小于掩码中1的个数
+	constexpr static uint64_t SelectBit(uint64_t u64Mask, uint64_t k) noexcept
+	{
+#ifdef GAME2048_HAS_BMI2
+		if (!std::is_constant_evaluated())
+		{
+			return std::countr_zero(_pdep_u64((uint64_t)1 << k, u64Mask));
+		}
+#endif
+		//没有PDEP时二分：低半部分的1不够k个就跳到高半部分，全程无分支
+		uint64_t u64Pos = 0;
+		for (uint64_t u64Half = 32; u64Half != 0; u64Half >>= 1)
+		{
+			uint64_t u64Low = std::popcount((u64Mask >> u64Pos) & (((uint64_t)1 << u64Half) - 1));
+			uint64_t u64Skip = k >= u64Low;
+			k -= u64Skip * u64Low;
+			u64Pos += u64Skip * u64Half;
+		}
+		return u64Pos;
+	}
+
+	//用fnBelow(空格数)在所有空格中选出一个，返回其下标；没有空格时返回u64TotalSize，不调用fnBelow
+	template<typename Below>
+	constexpr uint64_t PickEmpty(Below &&fnBelow) const
+	{
+		Mask mskEmpty = EmptyMask();
+		if (mskEmpty == 0)
+		{
+			return u64TotalSize;
+		}
+		return SelectBit(mskEmpty, fnBelow((uint64_t)std::popcount(mskEmpty)));
+	}
+
+	//查找所有格子的相邻，存在相邻且数值相同的格子则返回true
+	constexpr bool HasPossibleMerges(void) const noexcept
+	{
+		//相邻格子异或为0即相等，水平方向每行只比较前3个，垂直方向只比较前3行
+		return (ZeroNibbleMask(u64Board ^ (u64Board >> 4)) & 0x0111'0111'0111'0111) != 0 ||
+			(ZeroNibbleMask(u64Board ^ (u64Board >> 16)) & 0x0000'1111'1111'1111) != 0;
+	}
+
+	constexpr uint8_t MaxExp(void) const noexcept
+	{
+		uint8_t u8Max = 0;
+		for (uint64_t i = 0; i < u64TotalSize; ++i)
+		{
+			uint8_t u8Cur = GetExp(i);
+			u8Max = u8Cur > u8Max ? u8Cur : u8Max;
+		}
+		return u8Max;
+	}
+
+	//====================移动合并====================
+	//整盘移动：每行查一次表，上下方向先转置成行再查表，最后转置回来
+	MoveResult Move(Direction dMove) const noexcept;
+
+	//合法方向掩码：第d位为1代表方向d可以移动，为0则整盘无路可走
+	uint8_t LegalMoves(void) const noexcept;
+
+	//====================与数值数组互转====================
+	constexpr static uint8_t ValueToExp(uint64_t u64Value) noexcept
+	{
+		return u64Value == 0 ? 0 : (uint8_t)std::countr_zero(u64Value);
+	}
+
+	constexpr static uint64_t ExpToValue(uint8_t u8Exp) noexcept
+	{
+		return u8Exp == 0 ? 0 : (uint64_t)1 << u8Exp;
+	}
+
+	constexpr static BitBoard FromArray(const uint64_t(&u64Tile)[u64Height][u64Width]) noexcept
+	{
+		BitBoard bbRet{};
+		for (uint64_t Y = 0; Y < u64Height; ++Y)
+		{
+			for (uint64_t X = 0; X < u64Width; ++X)
+			{
+				bbRet.SetExp(X, Y, ValueToExp(u64Tile[Y][X]));
+			}
+		}
+		return bbRet;
+	}
+
+	constexpr void ToArray(uint64_t(&u64Tile)[u64Height][u64Width]) const noexcept
+	{
+		for (uint64_t Y = 0; Y < u64Height; ++Y)
+		{
+			for (uint64_t X = 0; X < u64Width; ++X)
+			{
+				u64Tile[Y][X] = ExpToValue(GetExp(X, Y));
+			}
+		}
+	}
+};
+
+inline BitBoard::MoveResult BitBoard::Move(Direction dMove) const noexcept
+{
+	const MoveTable &mtTable = MoveTable::Get();
+
+	bool bVertical = (dMove == Up || dMove == Dn);
+	bool bToLow = (dMove == Up || dMove == Lt);//向低位（左/上）靠拢
+
+	BitBoard bbSrc = bVertical ? Transpose() : *this;
+
+	MoveResult mrRet{};
+	for (uint64_t Y = 0; Y < u64Height; ++Y)
+	{
+		const RowMoveEntry &rmeRow = bToLow ? mtTable.Left(bbSrc.GetRow(Y)) : mtTable.Right(bbSrc.GetRow(Y));
+		mrRet.bbBoard.u64Board |= (uint64_t)rmeRow.u16Row << (Y * 16);
+		mrRet.u32Score += rmeRow.u32Score;
+		mrRet.u16MergeMask |= rmeRow.u16MergeMask;
+		mrRet.u8Merges += rmeRow.u8Merges;
+		mrRet.bChanged |= rmeRow.bChanged;
+	}
+
+	if (bVertical)
+	{
+		mrRet.bbBoard = mrRet.bbBoard.Transpose();
+	}
+
+	return mrRet;
+}
+
+inline uint8_t BitBoard::LegalMoves(void) const noexcept
+{
+	const MoveTable &mtTable = MoveTable::Get();
+
+	//4行各查一次得到左右，转置后4行（即原来的4列）各查一次得到上下
+	BitBoard bbTrans = Transpose();
+	uint8_t u8Row = 0;
+	uint8_t u8Col = 0;
+	for (uint64_t Y = 0; Y < u64Height; ++Y)
+	{
+		u8Row |= mtTable.RowLegal(GetRow(Y));
+		u8Col |= mtTable.RowLegal(bbTrans.GetRow(Y));
+	}
+
+	return
+		((u8Col & MoveTable::u8RowLegalLeft) ? 1 << Up : 0) |
+		((u8Col & MoveTable::u8RowLegalRight) ? 1 << Dn : 0) |
+		((u8Row & MoveTable::u8RowLegalLeft) ? 1 << Lt : 0) |
+		((u8Row & MoveTable::u8RowLegalRight) ? 1 << Rt : 0);
+}
+
+//按行存储的W*H棋盘中，按移动方向取第u64Line条线的第u64Pos个格子的下标，u64Pos = 0为靠拢的一侧
+template<uint64_t W, uint64_t H>
+constexpr uint64_t Board_LineIndex(Direction dMove, uint64_t u64Line, uint64_t u64Pos) noexcept
+{
+	switch (dMove)
+	{
+	case Up:
+		return u64Pos * W + u64Line;
+	case Dn:
+		return (H - 1 - u64Pos) * W + u64Line;
+	case Lt:
+		return u64Line * W + u64Pos;
+	default:
+		return u64Line * W + (W - 1 - u64Pos);
+	}
+}
+
+/*
+任意尺寸的半字节数组棋盘（最多64格）:
+
+格子(X,Y)位于第(Y * W + X)个半字节，每个uint64_t存16格
+移动时把每一条线取出到小数组里单次遍历压缩合并再写回，W和H都是编译期常量，循环可以完全展开
+*/
+template<uint64_t W, uint64_t H>
+class NibbleBoard
+{
+public:
+	static_assert(W >= 2 && H >= 2 && W * H <= 64, "NibbleBoard supports 2x2 up to 64 cells");
+
+	using Mask = uint64_t;//每格一位的掩码
+	using MoveResult = Board_MoveResult<NibbleBoard>;
+
+	constexpr const static inline uint64_t u64Width = W;
+	constexpr const static inline uint64_t u64Height = H;
+	constexpr const static inline uint64_t u64TotalSize = W * H;
+
+	constexpr const static inline uint8_t u8MaxExp = 15;//半字节能表示的最大指数
+	constexpr const static inline Mask mskFull = u64TotalSize == 64 ? ~(Mask)0 : ((Mask)1 << u64TotalSize) - 1;//所有格子
+
+private:
+	constexpr const static inline uint64_t u64WordCount = (u64TotalSize + 15) / 16;
+
+	uint64_t u64Word[u64WordCount];
+
+private:
+	constexpr static uint64_t LineIndex(Direction dMove, uint64_t u64Line, uint64_t u64Pos) noexcept
+	{
+		return Board_LineIndex<W, H>(dMove, u64Line, u64Pos);
+	}
+
+	template<uint64_t u64LineCount, uint64_t u64LineLength>
+	constexpr MoveResult MoveLines(Direction dMove) const noexcept
+	{
+		MoveResult mrRet{ *this, 0, 0, 0, false };
+		for (uint64_t l = 0; l < u64LineCount; ++l)
+		{
+			uint8_t u8Line[u64LineLength];
+			for (uint64_t p = 0; p < u64LineLength; ++p)
+			{
+				u8Line[p] = GetExp(LineIndex(dMove, l, p));
+			}
+
+			LineSlideResult lsrSlide = SlideLineToLow(u8Line);
+			if (!lsrSlide.bChanged)
+			{
+				continue;
+			}
+
+			for (uint64_t p = 0; p < u64LineLength; ++p)
+			{
+				mrRet.bbBoard.SetExp(LineIndex(dMove, l, p), u8Line[p]);
+			}
+			mrRet.u32Score += lsrSlide.u32Score;
+			mrRet.u16MergeMask |= lsrSlide.u16MergeMask;
+			mrRet.u8Merges += lsrSlide.u8Merges;
+			mrRet.bChanged = true;
+		}
+		return mrRet;
+	}
+
+public:
+	constexpr NibbleBoard(void) noexcept : u64Word{}
+	{}
+	~NibbleBoard(void) = default;
+
+	NibbleBoard(const NibbleBoard &) = default;
+	NibbleBoard &operator=(const NibbleBoard &) = default;
+
+	constexpr bool operator==(const NibbleBoard &_Right) const noexcept
+	{
+		for (uint64_t i = 0; i < u64WordCount; ++i)
+		{
+			if (u64Word[i] != _Right.u64Word[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	constexpr bool operator!=(const NibbleBoard &_Right) const noexcept
+	{
+		return !(*this == _Right);
+	}
+
+	//====================单个格子====================
+	constexpr uint8_t GetExp(uint64_t u64Index) const noexcept
+	{
+		return (u64Word[u64Index / 16] >> (u64Index % 16 * 4)) & 0xF;
+	}
+
+	constexpr void SetExp(uint64_t u64Index, uint8_t u8Exp) noexcept
+	{
+		uint64_t &u64Cur = u64Word[u64Index / 16];
+		uint64_t u64Shift = u64Index % 16 * 4;
+		u64Cur = (u64Cur & ~((uint64_t)0xF << u64Shift)) | ((uint64_t)(u8Exp & 0xF) << u64Shift);
+	}
+
+	constexpr uint8_t GetExp(uint64_t X, uint64_t Y) const noexcept
+	{
+		return GetExp(Y * W + X);
+	}
+
+	constexpr void SetExp(uint64_t X, uint64_t Y, uint8_t u8Exp) noexcept
+	{
+		SetExp(Y * W + X, u8Exp);
+	}
+
+	//====================统计====================
+	constexpr Mask EmptyMask(void) const noexcept
+	{
+		//每个字按位棋盘的方法处理，末尾不足16格的部分是0，会被当成空格，最后用mskFull去掉
+		Mask mskRet = 0;
+		for (uint64_t i = 0; i < u64WordCount; ++i)
+		{
+			mskRet |= (Mask)BitBoard::CompressNibbleBits(BitBoard::ZeroNibbleMask(u64Word[i])) << (i * 16);
+		}
+		return mskRet & mskFull;
+	}
+
+	constexpr uint64_t CountEmpty(void) const noexcept
+	{
+		return std::popcount(EmptyMask());
+	}
+
+	//用fnBelow(空格数)在所有空格中选出一个，返回其下标；没有空格时返回u64TotalSize，不调用fnBelow
+	template<typename Below>
+	constexpr uint64_t PickEmpty(Below &&fnBelow) const
+	{
+		Mask mskEmpty = EmptyMask();
+		if (mskEmpty == 0)
+		{
+			return u64TotalSize;
+		}
+		return BitBoard::SelectBit(mskEmpty, fnBelow((uint64_t)std::popcount(mskEmpty)));
+	}
+
+	//查找所有格子的相邻，存在相邻且数值相同的格子则返回true
+	constexpr bool HasPossibleMerges(void) const noexcept
+	{
+		for (uint64_t Y = 0; Y < H; ++Y)
+		{
+			for (uint64_t X = 0; X < W; ++X)
+			{
+				uint8_t u8Cur = GetExp(X, Y);
+
+				//向右向下检测（避免越界）
+				if ((X + 1 < W && GetExp(X + 1, Y) == u8Cur) ||
+					(Y + 1 < H && GetExp(X, Y + 1) == u8Cur))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	constexpr uint8_t MaxExp(void) const noexcept
+	{
+		uint8_t u8Max = 0;
+		for (uint64_t i = 0; i < u64TotalSize; ++i)
+		{
+			uint8_t u8Cur = GetExp(i);
+			u8Max = u8Cur > u8Max ? u8Cur : u8Max;
+		}
+		return u8Max;
+	}
+
+	//====================移动合并====================
+	constexpr MoveResult Move(Direction dMove) const noexcept
+	{
+		if (dMove == Up || dMove == Dn)
+		{
+			return MoveLines<W, H>(dMove);//每列一条线
+		}
+		return MoveLines<H, W>(dMove);//每行一条线
+	}
+
+	//合法方向掩码：第d位为1代表方向d可以移动
+	constexpr uint8_t LegalMoves(void) const noexcept
+	{
+		//一条线可以向低位移动，当且仅当存在空格后面跟着非空格，或者两个相邻的非空格可以合并
+		auto LineCanMove = [this](Direction dMove) -> bool
+		{
+			bool bVertical = (dMove == Up || dMove == Dn);
+			uint64_t u64Lines = bVertical ? W : H;
+			uint64_t u64Length = bVertical ? H : W;
+			for (uint64_t u64Line = 0; u64Line < u64Lines; ++u64Line)
+			{
+				uint8_t u8Prev = GetExp(LineIndex(dMove, u64Line, 0));
+				for (uint64_t u64Pos = 1; u64Pos < u64Length; ++u64Pos)
+				{
+					uint8_t u8Cur = GetExp(LineIndex(dMove, u64Line, u64Pos));
+					if (u8Cur != 0 && (u8Prev == 0 || (u8Prev == u8Cur && u8Cur != BitBoard::u8MaxExp)))
+					{
+						return true;
+					}
+					u8Prev = u8Cur;
+				}
+			}
+			return false;
+		};
+
+		uint8_t u8Ret = 0;
+		for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+		{
+			u8Ret |= LineCanMove((Direction)d) ? 1 << d : 0;
+		}
+		return u8Ret;
+	}
+
+	//====================与数值数组互转====================
+	constexpr static NibbleBoard FromArray(const uint64_t(&u64Tile)[H][W]) noexcept
+	{
+		NibbleBoard nbRet{};
+		for (uint64_t Y = 0; Y < H; ++Y)
+		{
+			for (uint64_t X = 0; X < W; ++X)
+			{
+				nbRet.SetExp(X, Y, BitBoard::ValueToExp(u64Tile[Y][X]));
+			}
+		}
+		return nbRet;
+	}
+
+	constexpr void ToArray(uint64_t(&u64Tile)[H][W]) const noexcept
+	{
+		for (uint64_t Y = 0; Y < H; ++Y)
+		{
+			for (uint64_t X = 0; X < W; ++X)
+			{
+				u64Tile[Y][X] = BitBoard::ExpToValue(GetExp(X, Y));
+			}
+		}
+	}
+};
+
+/*
+大棋盘的字节数组棋盘（超过64格，例如8*8以上直到16*16及更大）:
+
+每格一个字节存指数，格子(X,Y)位于第(Y * W + X)个字节，指数最大为24（16777216），
+这样256格的棋盘单次移动的得分也不会超过uint32_t
+移动时每条线单次遍历压缩合并（同NibbleBoard），写回的同一遍里重建空格下标表
+空格下标表与每个空格在表中的位置一起维护，生成数字时选空格、填掉空格都是O(1)，不需要扫描整盘
+空格在表中的顺序取决于历史，随机选到哪一格仍然只取决于随机数流与走过的步骤，可以复现
+*/
+template<uint64_t W, uint64_t H>
+class ByteBoard
+{
+public:
+	static_assert(W >= 2 && H >= 2 && W <= 255 && H <= 255, "ByteBoard supports 2x2 up to 255x255");
+
+	using Index = std::conditional_t<(W * H <= 256), uint8_t, uint16_t>;//格子下标
+	using MoveResult = Board_MoveResult<ByteBoard>;
+
+	constexpr const static inline uint64_t u64Width = W;
+	constexpr const static inline uint64_t u64Height = H;
+	constexpr const static inline uint64_t u64TotalSize = W * H;
+
+	constexpr const static inline uint8_t u8MaxExp = 24;//不再合并的指数
+
+private:
+	uint8_t u8Cell[u64TotalSize];//每格的指数
+	Index idxEmpty[u64TotalSize];//空格下标表，前u32EmptyCount项有效
+	Index idxSlot[u64TotalSize];//每个空格在空格下标表中的位置，非空格的值没有意义
+	uint32_t u32EmptyCount;
+
+private:
+	constexpr static uint64_t LineIndex(Direction dMove, uint64_t u64Line, uint64_t u64Pos) noexcept
+	{
+		return Board_LineIndex<W, H>(dMove, u64Line, u64Pos);
+	}
+
+	constexpr void PushEmpty(uint64_t u64Index) noexcept
+	{
+		idxSlot[u64Index] = (Index)u32EmptyCount;
+		idxEmpty[u32EmptyCount++] = (Index)u64Index;
+	}
+
+	//与NibbleBoard相同：某条线上有空格后面跟着非空格，或者相邻两格可以合并，这个方向就能移动，找到一处即可返回
+	template<Direction dMove>
+	constexpr bool LineCanMove(void) const noexcept
+	{
+		constexpr const uint64_t u64LineCount = (dMove == Up || dMove == Dn) ? W : H;
+		constexpr const uint64_t u64LineLength = (dMove == Up || dMove == Dn) ? H : W;
+		for (uint64_t l = 0; l < u64LineCount; ++l)
+		{
+			uint8_t u8Prev = u8Cell[LineIndex(dMove, l, 0)];
+			for (uint64_t p = 1; p < u64LineLength; ++p)
+			{
+				uint8_t u8Cur = u8Cell[LineIndex(dMove, l, p)];
+				if (u8Cur != 0 && (u8Prev == 0 || (u8Prev == u8Cur && u8Cur != u8MaxExp)))
+				{
+					return true;
+				}
+				u8Prev = u8Cur;
+			}
+		}
+		return false;
+	}
+
+	//用表尾的空格填到被删除的位置
+	constexpr void EraseEmpty(uint64_t u64Index) noexcept
+	{
+		Index idxLast = idxEmpty[--u32EmptyCount];
+		Index idxPos = idxSlot[u64Index];
+		idxEmpty[idxPos] = idxLast;
+		idxSlot[idxLast] = idxPos;
+	}
+
+	//方向作为模板参数，每个格子的下标计算都是常量折叠后的简单乘加
+	template<Direction dMove>
+	constexpr MoveResult MoveLines(void) const noexcept
+	{
+		constexpr const uint64_t u64LineCount = (dMove == Up || dMove == Dn) ? W : H;
+		constexpr const uint64_t u64LineLength = (dMove == Up || dMove == Dn) ? H : W;
+
+		MoveResult mrRet{ *this, 0, 0, 0, false };
+		ByteBoard &bbNew = mrRet.bbBoard;
+		bbNew.u32EmptyCount = 0;
+
+		uint32_t u32Merges = 0;
+		for (uint64_t l = 0; l < u64LineCount; ++l)
+		{
+			uint8_t u8Line[u64LineLength];
+			for (uint64_t p = 0; p < u64LineLength; ++p)
+			{
+				u8Line[p] = u8Cell[LineIndex(dMove, l, p)];
+			}
+
+			LineSlideResult lsrSlide = SlideLineToLow<u64LineLength, u8MaxExp>(u8Line);
+
+			//没有变化的线也要写回，空格下标表是整盘重建的
+			for (uint64_t p = 0; p < u64LineLength; ++p)
+			{
+				uint64_t u64Index = LineIndex(dMove, l, p);
+				bbNew.u8Cell[u64Index] = u8Line[p];
+				if (u8Line[p] == 0)
+				{
+					bbNew.PushEmpty(u64Index);
+				}
+			}
+			mrRet.u32Score += lsrSlide.u32Score;
+			mrRet.u16MergeMask |= lsrSlide.u16MergeMask;
+			mrRet.bChanged |= lsrSlide.bChanged;
+			u32Merges += lsrSlide.u8Merges;
+		}
+		mrRet.u8Merges = (uint8_t)(u32Merges < 255 ? u32Merges : 255);//超过255时饱和
+		return mrRet;
+	}
+
+public:
+	constexpr ByteBoard(void) noexcept :
+		u8Cell{},
+		idxEmpty{},
+		idxSlot{},
+		u32EmptyCount(0)
+	{
+		for (uint64_t i = 0; i < u64TotalSize; ++i)
+		{
+			PushEmpty(i);
+		}
+	}
+	~ByteBoard(void) = default;
+
+	ByteBoard(const ByteBoard &) = default;
+	ByteBoard &operator=(const ByteBoard &) = default;
+
+	//只比较格子，空格下标表的顺序不影响局面
+	constexpr bool operator==(const ByteBoard &_Right) const noexcept
+	{
+		for (uint64_t i = 0; i < u64TotalSize; ++i)
+		{
+			if (u8Cell[i] != _Right.u8Cell[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	constexpr bool operator!=(const ByteBoard &_Right) const noexcept
+	{
+		return !(*this == _Right);
+	}
+
+	//====================单个格子====================
+	constexpr uint8_t GetExp(uint64_t u64Index) const noexcept
+	{
+		return u8Cell[u64Index];
+	}
+
+	//空与非空之间切换时同步更新空格下标表
+	constexpr void SetExp(uint64_t u64Index, uint8_t u8Exp) noexcept
+	{
+		uint8_t u8Old = u8Cell[u64Index];
+		if (u8Old == 0 && u8Exp != 0)
+		{
+			EraseEmpty(u64Index);
+		}
+		else if (u8Old != 0 && u8Exp == 0)
+		{
+			PushEmpty(u64Index);
+		}
+		u8Cell[u64Index] = u8Exp;
+	}
+
+	constexpr uint8_t GetExp(uint64_t X, uint64_t Y) const noexcept
+	{
+		return GetExp(Y * W + X);
+	}
+
+	constexpr void SetExp(uint64_t X, uint64_t Y, uint8_t u8Exp) noexcept
+	{
+		SetExp(Y * W + X, u8Exp);
+	}
+
+	//====================统计====================
+	constexpr uint64_t CountEmpty(void) const noexcept
+	{
+		return u32EmptyCount;
+	}
+
+	//用fnBelow(空格数)在所有空格中选出一个，返回其下标；没有空格时返回u64TotalSize，不调用fnBelow
+	template<typename Below>
+	constexpr uint64_t PickEmpty(Below &&fnBelow) const
+	{
+		if (u32EmptyCount == 0)
+		{
+			return u64TotalSize;
+		}
+		return idxEmpty[fnBelow((uint64_t)u32EmptyCount)];
+	}
+
+	//查找所有格子的相邻，存在相邻且数值相同的格子则返回true
+	constexpr bool HasPossibleMerges(void) const noexcept
+	{
+		for (uint64_t Y = 0; Y < H; ++Y)
+		{
+			for (uint64_t X = 0; X < W; ++X)
+			{
+				uint8_t u8Cur = GetExp(X, Y);
+
+				//向右向下检测（避免越界）
+				if ((X + 1 < W && GetExp(X + 1, Y) == u8Cur) ||
+					(Y + 1 < H && GetExp(X, Y + 1) == u8Cur))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	constexpr uint8_t MaxExp(void) const noexcept
+	{
+		uint8_t u8Max = 0;
+		for (uint64_t i = 0; i < u64TotalSize; ++i)
+		{
+			u8Max = u8Cell[i] > u8Max ? u8Cell[i] : u8Max;
+		}
+		return u8Max;
+	}
+
+	//====================移动合并====================
+	constexpr MoveResult Move(Direction dMove) const noexcept
+	{
+		switch (dMove)
+		{
+		case Up:
+			return MoveLines<Up>();
+		case Dn:
+			return MoveLines<Dn>();
+		case Lt:
+			return MoveLines<Lt>();
+		default:
+			return MoveLines<Rt>();
+		}
+	}
+
+	//合法方向掩码：第d位为1代表方向d可以移动
+	constexpr uint8_t LegalMoves(void) const noexcept
+	{
+		return
+			(LineCanMove<Up>() ? 1 << Up : 0) |
+			(LineCanMove<Dn>() ? 1 << Dn : 0) |
+			(LineCanMove<Lt>() ? 1 << Lt : 0) |
+			(LineCanMove<Rt>() ? 1 << Rt : 0);
+	}
+
+	//====================与数值数组互转====================
+	constexpr static ByteBoard FromArray(const uint64_t(&u64Tile)[H][W]) noexcept
+	{
+		ByteBoard bbRet{};
+		for (uint64_t Y = 0; Y < H; ++Y)
+		{
+			for (uint64_t X = 0; X < W; ++X)
+			{
+				bbRet.SetExp(X, Y, BitBoard::ValueToExp(u64Tile[Y][X]));
+			}
+		}
+		return bbRet;
+	}
+
+	constexpr void ToArray(uint64_t(&u64Tile)[H][W]) const noexcept
+	{
+		for (uint64_t Y = 0; Y < H; ++Y)
+		{
+			for (uint64_t X = 0; X < W; ++X)
+			{
+				u64Tile[Y][X] = BitBoard::ExpToValue(GetExp(X, Y));
+			}
+		}
+	}
+};
+
+//按尺寸选择最合适的存储：4*4用位棋盘（查表移动），64格以内用半字节数组，更大的用字节数组
+template<uint64_t W, uint64_t H>
+struct Board_Select
+{
+	using type = std::conditional_t<(W * H <= 64), NibbleBoard<W, H>, ByteBoard<W, H>>;
+};
+
+template<>
+struct Board_Select<4, 4>
+{
+	using type = BitBoard;
+};
+
+template<uint64_t W, uint64_t H>
+using Board_T = typename Board_Select<W, H>::type;
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <deque>
+
+/*
+协程调度:
+
+等待输入的游戏流程（主循环、重开与退出的询问）写成协程，等按键时挂起而不是阻塞线程，
+一个线程上的调度器可以驱动任意多局，按键来自终端、套接字还是脚本都一样：
+	输入源把按键Push进每局自己的Key_Channel
+	有协程在等这个通道时，它被放进调度器的就绪队列（不在Push里直接恢复，避免重入与递归过深）
+	调度器的RunReady依次恢复就绪的协程，直到它们再次挂起或结束
+*/
+class Coroutine_Scheduler
+{
+private:
+	std::deque<std::coroutine_handle<>> dqReady;
+
+public:
+	Coroutine_Scheduler(void) = default;
+	~Coroutine_Scheduler(void) = default;
+
+	Coroutine_Scheduler(const Coroutine_Scheduler &) = delete;
+	Coroutine_Scheduler &operator=(const Coroutine_Scheduler &) = delete;
+
+	void Schedule(std::coroutine_handle<> hCoro)
+	{
+		dqReady.push_back(hCoro);
+	}
+
+	bool HasReady(void) const noexcept
+	{
+		return !dqReady.empty();
+	}
+
+	//恢复所有就绪的协程（包括运行期间新就绪的），返回恢复的次数
+	size_t RunReady(void)
+	{
+		size_t szCount = 0;
+		while (!dqReady.empty())
+		{
+			std::coroutine_handle<> hCoro = dqReady.front();
+			dqReady.pop_front();
+			hCoro.resume();
+			++szCount;
+		}
+		return szCount;
+	}
+};
+
+/*
+协程任务:
+
+惰性启动：创建时不运行，被co_await或者Start时才开始
+被co_await时记下等待者，结束时直接转移回等待者（对称转移），嵌套再深也不会增加调用栈
+异常保存在任务里，在等待者的co_await处（或Result）重新抛出
+*/
+template<typename T = void>
+class Game_Task;
+
+namespace Game_Task_Detail
+{
+	template<typename Promise>
+	struct Final_Awaiter
+	{
+		bool await_ready(void) const noexcept
+		{
+			return false;
+		}
+
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> hSelf) const noexcept
+		{
+			std::coroutine_handle<> hCont = hSelf.promise().hContinuation;
+			return hCont ? hCont : std::noop_coroutine();
+		}
+
+		void await_resume(void) const noexcept
+		{}
+	};
+
+	struct Promise_Base
+	{
+		std::coroutine_handle<> hContinuation;//等待这个任务的协程，顶层任务为空
+		std::exception_ptr epError;
+
+		std::suspend_always initial_suspend(void) const noexcept
+		{
+			return {};
+		}
+
+		void unhandled_exception(void) noexcept
+		{
+			epError = std::current_exception();
+		}
+	};
+
+	template<typename T>
+	struct Promise : Promise_Base
+	{
+		std::optional<T> optValue;
+
+		Game_Task<T> get_return_object(void) noexcept;
+
+		Final_Awaiter<Promise> final_suspend(void) const noexcept
+		{
+			return {};
+		}
+
+		template<typename U>
+		void return_value(U &&uValue)
+		{
+			optValue.emplace(std::forward<U>(uValue));
+		}
+
+		T TakeResult(void)
+		{
+			if (epError)
+			{
+				std::rethrow_exception(epError);
+			}
+			return std::move(*optValue);
+		}
+	};
+
+	template<>
+	struct Promise<void> : Promise_Base
+	{
+		Game_Task<void> get_return_object(void) noexcept;
+
+		Final_Awaiter<Promise> final_suspend(void) const noexcept
+		{
+			return {};
+		}
+
+		void return_void(void) const noexcept
+		{}
+
+		void TakeResult(void)
+		{
+			if (epError)
+			{
+				std::rethrow_exception(epError);
+			}
+		}
+	};
+}
+
+template<typename T>
+class Game_Task
+{
+public:
+	using promise_type = Game_Task_Detail::Promise<T>;
+
+private:
+	std::coroutine_handle<promise_type> hSelf;
+
+public:
+	explicit Game_Task(std::coroutine_handle<promise_type> _hSelf) noexcept :
+		hSelf(_hSelf)
+	{}
+	~Game_Task(void)
+	{
+		if (hSelf)
+		{
+			hSelf.destroy();
+		}
+	}
+
+	Game_Task(Game_Task &&_Other) noexcept :
+		hSelf(std::exchange(_Other.hSelf, nullptr))
+	{}
+	Game_Task &operator=(Game_Task &&_Other) noexcept
+	{
+		if (this != &_Other)
+		{
+			if (hSelf)
+			{
+				hSelf.destroy();
+			}
+			hSelf = std::exchange(_Other.hSelf, nullptr);
+		}
+		return *this;
+	}
+
+	Game_Task(const Game_Task &) = delete;
+	Game_Task &operator=(const Game_Task &) = delete;
+
+	//====================在协程中等待====================
+	bool await_ready(void) const noexcept
+	{
+		return false;
+	}
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> hCaller) noexcept
+	{
+		hSelf.promise().hContinuation = hCaller;
+		return hSelf;
+	}
+
+	T await_resume(void)
+	{
+		return hSelf.promise().TakeResult();
+	}
+
+	//====================作为顶层任务====================
+	//运行到第一次挂起（或者结束）
+	void Start(void)
+	{
+		hSelf.resume();
+	}
+
+	bool Done(void) const noexcept
+	{
+		return hSelf.done();
+	}
+
+	//结束后取结果，协程中抛出的异常在这里重新抛出
+	T Result(void)
+	{
+		return hSelf.promise().TakeResult();
+	}
+};
+
+namespace Game_Task_Detail
+{
+	template<typename T>
+	Game_Task<T> Promise<T>::get_return_object(void) noexcept
+	{
+		return Game_Task<T>{ std::coroutine_handle<Promise<T>>::from_promise(*this) };
+	}
+
+	inline Game_Task<void> Promise<void>::get_return_object(void) noexcept
+	{
+		return Game_Task<void>{ std::coroutine_handle<Promise<void>>::from_promise(*this) };
+	}
+}
+
+/*
+按键通道:
+
+一局游戏的输入队列，只有这局的协程读取（co_await Next()），输入源随时Push
+队列为定长环形缓冲，满了之后新的按键被丢弃（与终端输入队列的处理一致）
+*/
+template<typename Key, size_t N = 256>
+class Key_Channel
+{
+private:
+	Coroutine_Scheduler &csOwner;
+
+	Key arrQueue[N];
+	size_t szHead;
+	size_t szCount;
+	std::coroutine_handle<> hWaiting;//正在等按键的协程
+
+public:
+	struct Awaiter
+	{
+		Key_Channel &kcSelf;
+
+		bool await_ready(void) const noexcept
+		{
+			return kcSelf.szCount != 0;
+		}
+
+		void await_suspend(std::coroutine_handle<> hCaller) noexcept
+		{
+			kcSelf.hWaiting = hCaller;
+		}
+
+		Key await_resume(void) noexcept
+		{
+			Key stRet{};
+			kcSelf.TryPop(stRet);
+			return stRet;
+		}
+	};
+
+public:
+	explicit Key_Channel(Coroutine_Scheduler &_csOwner) :
+		csOwner(_csOwner),
+		arrQueue{},
+		szHead(0),
+		szCount(0),
+		hWaiting(nullptr)
+	{}
+	~Key_Channel(void) = default;
+
+	Key_Channel(const Key_Channel &) = delete;
+	Key_Channel &operator=(const Key_Channel &) = delete;
+
+	//放入一个按键，队列满时丢弃并返回false；有协程在等则让它就绪
+	bool Push(const Key &stKey)
+	{
+		if (szCount == N)
+		{
+			return false;
+		}
+
+		arrQueue[(szHead + szCount) % N] = stKey;
+		++szCount;
+
+		if (hWaiting)
+		{
+			csOwner.Schedule(std::exchange(hWaiting, nullptr));
+		}
+		return true;
+	}
+
+	//不挂起地取一个已经到达的按键，没有则返回false
+	bool TryPop(Key &stKey) noexcept
+	{
+		if (szCount == 0)
+		{
+			return false;
+		}
+
+		stKey = arrQueue[szHead];
+		szHead = (szHead + 1) % N;
+		--szCount;
+		return true;
+	}
+
+	//在协程中等待下一个按键：co_await kcInput.Next()
+	Awaiter Next(void) noexcept
+	{
+		return Awaiter{ *this };
+	}
+
+	bool Empty(void) const noexcept
+	{
+		return szCount == 0;
+	}
+
+	bool Full(void) const noexcept
+	{
+		return szCount == N;
+	}
+
+	//是否有协程正在等这个通道
+	bool HasWaiter(void) const noexcept
+	{
+		return (bool)hWaiting;
+	}
+};
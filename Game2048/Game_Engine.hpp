@@ -0,0 +1,285 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <random>
+#include <type_traits>
+#include <bit>
+#include <concepts>
+
+#include "Game_Board.hpp"
+#include "Game_Random.hpp"
+#include "Game_Stats.hpp"
+
+//随机数生成器是否可以只用一个位置描述状态（例如Rand_Counter），快照时只需存位置
+template<typename RandPolicy>
+concept Rand_Positionable = requires(RandPolicy randGen, uint64_t u64Position)
+{
+	{ randGen.GetPosition() } -> std::convertible_to<uint64_t>;
+	randGen.SetPosition(u64Position);
+};
+
+//游戏状态
+enum GameStatus
+{
+	InGame = 0,
+	WinGame,
+	LostGame,
+};
+
+/*
+纯游戏逻辑:
+
+只包含棋盘、随机数生成器与游戏状态，不涉及任何终端输入输出
+可以随意拷贝（拷贝即得到一个完全相同的分支局面），放进容器、搜索树或者线程池里都没有额外开销
+终端界面见main.cpp中的Game2048，它只是这个类外面的一层包装
+棋盘尺寸W*H是编译期常量，存储方式由Board_T<W, H>按尺寸选择（4*4为位棋盘）
+随机数生成器由模板参数RandPolicy决定，接口要求见Game_Random.hpp
+*/
+template<uint64_t W = 4, uint64_t H = 4, typename RandPolicy = Rand_Counter>
+class Game2048_Engine
+{
+public:
+	using Board = Board_T<W, H>;
+
+	constexpr const static inline uint64_t u64Width = W;
+	constexpr const static inline uint64_t u64Height = H;
+	constexpr const static inline uint64_t u64TotalSize = W * H;
+	constexpr const static inline uint8_t u8WinExp = 11;//2048的指数
+
+	//快照中随机数生成器的状态：可定位的生成器只存位置，否则存整个生成器
+	using RandState = std::conditional_t<Rand_Positionable<RandPolicy>, uint64_t, RandPolicy>;
+
+	//局面快照，撤销与重做用，4*4默认配置下只有32字节
+	struct Snapshot
+	{
+		uint64_t u64Score;
+		RandState rsRand;
+		Board bbTile;
+		uint8_t u8Status;
+	};
+
+private:
+	Board bbTile;//每格存指数的棋盘，空格子为0
+
+	uint8_t u8LegalMask;//合法方向掩码，第d位为1代表方向d可以移动，每次棋盘变化后更新
+	GameStatus enGameStatus;//游戏状态
+	uint64_t u64Score;//累计合并得分
+
+	RandPolicy randGen;//随机数生成器
+	uint64_t u64Spawn4Threshold;//生成4的阈值，随机数小于它则生成4（由两个权重归一化得到）
+
+private:
+	//====================辅助函数====================
+	uint8_t GenerateRandTileExp(void)
+	{
+		return randGen.Next() < u64Spawn4Threshold ? 2 : 1;//4和2的指数
+	}
+
+	void UpdateLegalMask(void) noexcept
+	{
+		u8LegalMask = bbTile.LegalMoves();
+		Game2048_Stats::Add(Game2048_Stats::LegalMaskUpdate);
+	}
+
+	//====================刷出数字====================
+	bool SpawnRandomTile(void)
+	{
+		//在剩余格子中均匀选一个，由棋盘直接给出（位掩码取第k个1或者查空格下标表），不需要遍历棋盘
+		uint64_t u64Index = bbTile.PickEmpty([this](uint64_t u64EmptyCount) -> uint64_t
+		{
+			return randGen.Below(u64EmptyCount);
+		});
+		if (u64Index == Board::u64TotalSize)//没有空格
+		{
+			return false;
+		}
+
+		uint8_t u8Exp = GenerateRandTileExp();
+		bbTile.SetExp(u64Index, u8Exp);
+		Game2048_Stats::AddSpawn(u8Exp);
+
+		//没有任何一个方向可以移动则输
+		UpdateLegalMask();
+		if (u8LegalMask == 0)
+		{
+			enGameStatus = LostGame;//设置输
+		}
+
+		return true;
+	}
+
+public:
+	//构造
+	Game2048_Engine(uint64_t u64Seed = std::random_device{}(), double dSpawnWeights_2 = 0.9, double dSpawnWeights_4 = 0.1) :
+		Game2048_Engine(RandPolicy{ u64Seed }, dSpawnWeights_2, dSpawnWeights_4)
+	{}
+	//直接给定随机数生成器（例如由RandPolicy::Stream派生的流）
+	Game2048_Engine(const RandPolicy &_randGen, double dSpawnWeights_2, double dSpawnWeights_4) :
+		bbTile{},
+
+		u8LegalMask(0),
+		enGameStatus(),
+		u64Score(0),
+
+		randGen(_randGen),
+		u64Spawn4Threshold(Game2048_Random::ProbToThreshold(dSpawnWeights_4 / (dSpawnWeights_2 + dSpawnWeights_4)))
+	{}
+	~Game2048_Engine(void) = default;
+
+	//可以随意拷贝与移动
+	Game2048_Engine(const Game2048_Engine &) = default;
+	Game2048_Engine(Game2048_Engine &&) = default;
+	Game2048_Engine &operator=(const Game2048_Engine &) = default;
+	Game2048_Engine &operator=(Game2048_Engine &&) = default;
+
+	//====================重置游戏====================
+	void Reset(void)
+	{
+		//清除格子数据
+		bbTile = Board{};
+		//设置游戏状态为游戏中
+		enGameStatus = InGame;
+		u64Score = 0;
+
+		//在地图中随机两点生成
+		SpawnRandomTile();
+		SpawnRandomTile();
+	}
+
+	//====================移动合并====================
+	bool ProcessMove(Direction dMove)
+	{
+		Game2048_Stats::Add(Game2048_Stats::MoveAttempt);
+		if (enGameStatus != InGame)//不是游戏状态，直接退出
+		{
+			return false;
+		}
+
+		if (!(u8LegalMask & (1 << dMove)))//这个方向不能移动，不用真的去移动一次
+		{
+			return false;
+		}
+
+		//整盘查表移动，一排中已经合并过的数字不会再次合并的规则已经包含在表里
+		typename Board::MoveResult mrMove = bbTile.Move(dMove);
+		if (!mrMove.bChanged)//没有任何移动或合并
+		{
+			return false;
+		}
+
+		if constexpr (Game2048_Stats::bEnabled)//每次合并减少一个数字，空格的增加量就是合并次数
+		{
+			Game2048_Stats::Add(Game2048_Stats::MoveApply);
+			Game2048_Stats::AddMerges(mrMove.bbBoard.CountEmpty() - bbTile.CountEmpty());
+		}
+
+		bbTile = mrMove.bbBoard;
+		UpdateLegalMask();//赢了不再生成新值时也要保持正确
+		u64Score += mrMove.u32Score;
+
+		if (mrMove.u16MergeMask & ((uint16_t)1 << u8WinExp))//如果任何一个合并获得2048
+		{
+			enGameStatus = WinGame;//则设置游戏状态为赢
+		}
+
+		if (enGameStatus == InGame)//还是游戏状态，如果上面已经赢了，就没必要生成新值了，直接跳过
+		{
+			SpawnRandomTile();//这里会设置是否输
+		}
+
+		return true;
+	}
+
+	//赢了之后继续玩（批量模拟等需要玩到底的场景），下一次移动会照常生成新值
+	void ContinueAfterWin(void)
+	{
+		if (enGameStatus != WinGame)
+		{
+			return;
+		}
+
+		enGameStatus = InGame;
+		SpawnRandomTile();//赢的那一步没有生成新值，这里补上
+	}
+
+	//====================状态查询====================
+	const Board &GetBoard(void) const noexcept
+	{
+		return bbTile;
+	}
+
+	GameStatus GetStatus(void) const noexcept
+	{
+		return enGameStatus;
+	}
+
+	uint64_t GetEmptyCount(void) const noexcept
+	{
+		return bbTile.CountEmpty();
+	}
+
+	//合法方向掩码，第d位为1代表方向d可以移动，为0即无路可走
+	uint8_t LegalMoves(void) const noexcept
+	{
+		return u8LegalMask;
+	}
+
+	uint64_t GetScore(void) const noexcept
+	{
+		return u64Score;
+	}
+
+	const RandPolicy &GetRandom(void) const noexcept
+	{
+		return randGen;
+	}
+
+	//====================快照====================
+	Snapshot TakeSnapshot(void) const noexcept
+	{
+		Snapshot snRet{};
+		snRet.u64Score = u64Score;
+		if constexpr (Rand_Positionable<RandPolicy>)
+		{
+			snRet.rsRand = randGen.GetPosition();
+		}
+		else
+		{
+			snRet.rsRand = randGen;
+		}
+		snRet.bbTile = bbTile;
+		snRet.u8Status = (uint8_t)enGameStatus;
+		return snRet;
+	}
+
+	//恢复快照，之后生成的数字与拍快照时接着玩完全一致
+	void RestoreSnapshot(const Snapshot &snLoad) noexcept
+	{
+		u64Score = snLoad.u64Score;
+		if constexpr (Rand_Positionable<RandPolicy>)
+		{
+			randGen.SetPosition(snLoad.rsRand);
+		}
+		else
+		{
+			randGen = snLoad.rsRand;
+		}
+		bbTile = snLoad.bbTile;
+		UpdateLegalMask();//可以由棋盘得到，不占快照空间
+		enGameStatus = (GameStatus)snLoad.u8Status;
+	}
+
+	//直接设置棋盘（调试或从外部局面开始），合法方向随之重新计算
+	void SetBoard(const Board &bbBoard) noexcept
+	{
+		bbTile = bbBoard;
+		UpdateLegalMask();
+	}
+};
+
+static_assert(std::is_trivially_copyable_v<Game2048_Engine<4, 4, Rand_Counter>>, "Game2048_Engine must stay trivially copyable");
+static_assert(std::is_trivially_copyable_v<Game2048_Engine<4, 4, Rand_Xoshiro256pp>>, "Game2048_Engine must stay trivially copyable");
+static_assert(std::is_trivially_copyable_v<Game2048_Engine<6, 6, Rand_Counter>>, "Game2048_Engine must stay trivially copyable");
+static_assert(std::is_trivially_copyable_v<Game2048_Engine<16, 16, Rand_Counter>>, "Game2048_Engine must stay trivially copyable");
+static_assert(sizeof(Game2048_Engine<4, 4, Rand_Counter>::Snapshot) == 32, "Snapshot should stay compact");
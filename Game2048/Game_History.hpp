@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/*
+撤销与重做:
+
+固定容量的环形缓冲区，按绝对序号记录每一步之后的状态，序号对容量取模即为存放位置
+[u64First, u64Cur)可以撤销，(u64Cur, u64Last]可以重做
+新的一步会丢弃所有可重做的状态；超过容量时最旧的状态被覆盖
+状态存放在构造时一次分配好的堆上数组里（大容量的历史放在栈上会撑爆栈），记录一步只是一次拷贝，不再分配内存
+*/
+template<typename T, size_t N>
+class Undo_History
+{
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "Undo_History capacity must be a power of two");
+
+private:
+	constexpr const static inline uint64_t u64IndexMask = N - 1;
+
+	std::vector<T> vecEntry;
+	uint64_t u64First;//最旧的可用状态
+	uint64_t u64Cur;//当前状态
+	uint64_t u64Last;//最新的可重做状态
+
+public:
+	Undo_History(void) :
+		vecEntry(N),
+		u64First(0),
+		u64Cur(0),
+		u64Last(0)
+	{}
+	~Undo_History(void) = default;
+
+	//清空历史，以tInit为唯一的状态
+	void Reset(const T &tInit) noexcept
+	{
+		u64First = 0;
+		u64Cur = 0;
+		u64Last = 0;
+		vecEntry[0] = tInit;
+	}
+
+	//记录新的一步，之后的可重做状态全部丢弃
+	void Push(const T &tNew) noexcept
+	{
+		++u64Cur;
+		u64Last = u64Cur;
+		vecEntry[u64Cur & u64IndexMask] = tNew;
+
+		if (u64Cur - u64First >= N)//已满，丢弃最旧的一个
+		{
+			u64First = u64Cur - N + 1;
+		}
+	}
+
+	//后退一步并返回新的当前状态，无法撤销时返回NULL
+	const T *Undo(void) noexcept
+	{
+		if (u64Cur == u64First)
+		{
+			return NULL;
+		}
+
+		--u64Cur;
+		return &vecEntry[u64Cur & u64IndexMask];
+	}
+
+	//前进一步并返回新的当前状态，无法重做时返回NULL
+	const T *Redo(void) noexcept
+	{
+		if (u64Cur == u64Last)
+		{
+			return NULL;
+		}
+
+		++u64Cur;
+		return &vecEntry[u64Cur & u64IndexMask];
+	}
+
+	const T &Current(void) const noexcept
+	{
+		return vecEntry[u64Cur & u64IndexMask];
+	}
+
+	uint64_t UndoDepth(void) const noexcept
+	{
+		return u64Cur - u64First;
+	}
+
+	uint64_t RedoDepth(void) const noexcept
+	{
+		return u64Last - u64Cur;
+	}
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+//一条线（行或列）滑动的结果统计
+struct LineSlideResult
+{
+	uint32_t u32Score;//合并得分（合并出的数值之和）
+	uint16_t u16MergeMask;//合并产生的指数集合，第e位为1代表合并出了指数e（只记录e < 16）
+	uint8_t u8Merges;//合并次数（等于空出来的格子数）
+	bool bChanged;//是否发生了移动或合并
+};
+
+/*
+把一条线上的格子向下标0一侧单次遍历完成压缩与合并，结果原地写回
+与原始规则一致：刚合并过的格子不能再参与合并；指数u8MaxExp不再合并，防止存储溢出（半字节为15）
+N在编译期确定，循环可以完全展开
+*/
+template<size_t N, uint8_t u8MaxExp = 15>
+constexpr LineSlideResult SlideLineToLow(uint8_t(&u8Line)[N]) noexcept
+{
+	uint8_t u8Out[N] = {};
+	size_t szOutCount = 0;
+	bool bMerge = true;
+
+	LineSlideResult lsrRet{};
+	for (size_t i = 0; i < N; ++i)
+	{
+		uint8_t u8Cur = u8Line[i];
+		if (u8Cur == 0)
+		{
+			continue;
+		}
+
+		if (bMerge && szOutCount != 0 && u8Out[szOutCount - 1] == u8Cur && u8Cur < u8MaxExp)
+		{
+			uint8_t u8New = ++u8Out[szOutCount - 1];//合并，指数加一
+			lsrRet.u16MergeMask |= (uint16_t)((uint32_t)1 << u8New);
+			lsrRet.u32Score += (uint32_t)1 << u8New;
+			++lsrRet.u8Merges;
+			bMerge = false;
+		}
+		else
+		{
+			u8Out[szOutCount++] = u8Cur;//堆放
+			bMerge = true;
+		}
+	}
+
+	for (size_t i = 0; i < N; ++i)
+	{
+		lsrRet.bChanged |= u8Line[i] != u8Out[i];
+		u8Line[i] = u8Out[i];
+	}
+
+	return lsrRet;
+}
+
+/*
+行移动查找表:
+
+一行4个格子，每格4bit指数，一共只有65536种可能的行
+预先把所有行向左、向右滑动后的结果全部算好，之后整盘移动只需要按行查表
+行的打包格式与BitBoard一致：第X个格子位于第X个半字节，向左即向低位靠拢
+*/
+struct RowMoveEntry
+{
+	uint16_t u16Row;//移动后的行
+	uint16_t u16MergeMask;//本行合并产生的指数集合，第e位为1代表合并出了指数e
+	uint32_t u32Score;//本行合并得分（合并出的数值之和）
+	uint8_t u8Merges;//本行合并次数（等于空出来的格子数）
+	bool bChanged;//本行是否发生了移动或合并
+};
+
+class MoveTable
+{
+public:
+	constexpr const static inline size_t szRowCount = 65536;
+	constexpr const static inline uint8_t u8RowLegalLeft = 1 << 0;//这一行可以向左移动
+	constexpr const static inline uint8_t u8RowLegalRight = 1 << 1;//这一行可以向右移动
+
+private:
+	RowMoveEntry arrMove[2][szRowCount];//[0]向左，[1]向右，连续存放，批量移动时按下标直接读取
+	uint8_t arrRowLegal[szRowCount];//每行可以移动的方向，只有1字节，整张表64KB，判断合法方向时不用去读完整的移动表
+
+private:
+	static uint16_t ReverseRow(uint16_t u16Row) noexcept
+	{
+		return	(u16Row >> 12) | ((u16Row >> 4) & 0x00F0) |
+				((u16Row << 4) & 0x0F00) | (u16Row << 12);
+	}
+
+	static RowMoveEntry SlideLeft(uint16_t u16Row) noexcept
+	{
+		uint8_t u8Line[4] =
+		{
+			(uint8_t)((u16Row >> 0) & 0xF),
+			(uint8_t)((u16Row >> 4) & 0xF),
+			(uint8_t)((u16Row >> 8) & 0xF),
+			(uint8_t)((u16Row >> 12) & 0xF),
+		};
+		LineSlideResult lsrSlide = SlideLineToLow(u8Line);
+
+		RowMoveEntry rmeRet{};
+		rmeRet.u16Row = (uint16_t)(u8Line[0] | (u8Line[1] << 4) | (u8Line[2] << 8) | (u8Line[3] << 12));
+		rmeRet.u16MergeMask = lsrSlide.u16MergeMask;
+		rmeRet.u32Score = lsrSlide.u32Score;
+		rmeRet.u8Merges = lsrSlide.u8Merges;
+		rmeRet.bChanged = lsrSlide.bChanged;
+		return rmeRet;
+	}
+
+	MoveTable(void) noexcept
+	{
+		for (size_t i = 0; i < szRowCount; ++i)
+		{
+			uint16_t u16Row = (uint16_t)i;
+			arrMove[0][i] = SlideLeft(u16Row);
+
+			//向右等价于翻转后向左再翻转回来
+			uint16_t u16Rev = ReverseRow(u16Row);
+			RowMoveEntry rmeRight = SlideLeft(u16Rev);
+			rmeRight.u16Row = ReverseRow(rmeRight.u16Row);
+			arrMove[1][i] = rmeRight;
+
+			arrRowLegal[i] = (arrMove[0][i].bChanged ? u8RowLegalLeft : 0) | (arrMove[1][i].bChanged ? u8RowLegalRight : 0);
+		}
+	}
+
+public:
+	~MoveTable(void) = default;
+
+	MoveTable(const MoveTable &) = delete;
+	MoveTable(MoveTable &&) = delete;
+	MoveTable &operator=(const MoveTable &) = delete;
+	MoveTable &operator=(MoveTable &&) = delete;
+
+	//首次调用时构建（线程安全），之后直接返回
+	static const MoveTable &Get(void) noexcept
+	{
+		static const MoveTable mtInstance{};
+		return mtInstance;
+	}
+
+	const RowMoveEntry &Left(uint16_t u16Row) const noexcept
+	{
+		return arrMove[0][u16Row];
+	}
+
+	const RowMoveEntry &Right(uint16_t u16Row) const noexcept
+	{
+		return arrMove[1][u16Row];
+	}
+
+	//整张表的起始位置：向左的第i行在下标i，向右的第i行在下标szRowCount + i
+	const RowMoveEntry *Data(void) const noexcept
+	{
+		return &arrMove[0][0];
+	}
+
+	uint8_t RowLegal(uint16_t u16Row) const noexcept
+	{
+		return arrRowLegal[u16Row];
+	}
+};
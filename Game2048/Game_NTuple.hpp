@@ -0,0 +1,937 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "Game_Board.hpp"
+#include "Game_Random.hpp"
+#include "Game_Symmetry.hpp"
+#include "Game_BatchMove.hpp"
+#include "Game_Replay.hpp"
+
+/*
+N元组网络估值:
+
+每个元组是棋盘上固定的几个格子，这几个格子的指数按顺序拼成下标（每格4bit），在这个元组自己的权重表里取一个float
+整盘估值 = 每个元组在棋盘的8个对称变换上各取一次权重之和；同一元组的8个变换共用一张表，互相对称的局面估值相同
+所有元组的权重表首尾相接存在一个连续的float数组里，n格的元组每张表16^n项
+取下标时元组里相邻的格子合并成一段，一次移位与掩码取出整段（例如前6格就是棋盘的低24bit）
+
+估值的含义是移动之后（生成数字之前）的局面往后还能得到的分数，由NTuple_Trainer自我对弈学习
+训练时多个线程同时读写同一个权重数组，不加锁（Hogwild）：每个权重的读写都是relaxed的原子操作
+（x86与ARM上就是普通的读写），并发的更新偶尔会丢失，但不会读到撕裂的值；训练好的网络只读，用Evaluate
+
+存档格式（所有整数按小端序存储）：
+	偏移  类型      内容
+	0     char[8]   魔数"G2NTUPLE"
+	8     uint32    版本号
+	12    uint32    元组个数P
+	16    uint64    权重个数
+	24    uint64    权重数组在文件中的偏移（64的倍数）
+	32    uint64    已训练的局数
+	40    uint8[24] 保留，写0
+	64    P*8字节   每个元组：uint8格子数 + uint8[7]格子下标（Y * 4 + X），不足的写0
+	...   float[]   权重数组，从上面的偏移开始，按元组顺序首尾相接
+只读打开时直接映射整个文件（见Replay_File），权重不拷贝、不解析，多个进程共用同一份页缓存
+*/
+class NTuple_Network
+{
+public:
+	constexpr const static inline size_t szMaxTupleCells = 7;//16^7项的表已经有1GB
+	constexpr const static inline char cMagic[8] = { 'G', '2', 'N', 'T', 'U', 'P', 'L', 'E' };
+	constexpr const static inline uint32_t u32Version = 1;
+	constexpr const static inline size_t szHeaderSize = 64;
+	constexpr const static inline size_t szTupleBytes = 8;
+	constexpr const static inline size_t szWeightAlign = 64;
+	constexpr const static inline size_t szHugePage = (size_t)1 << 21;
+
+	enum Tuple_Set
+	{
+		Small = 0,//4格的2种直线与3种方块，约1.3MB，能放进缓存
+		Large,//6格的2种直线与2种2*3矩形，约268MB，更强，但每次估值有几次缓存未命中
+	};
+
+	struct Tuple
+	{
+		uint8_t u8Size;//格子数
+		uint8_t u8Cell[szMaxTupleCells];//格子下标（Y * 4 + X）
+	};
+
+	//一步贪心的结果：得分 + 移动后局面估值最大的方向
+	struct Decision
+	{
+		Direction dBest;//没有合法方向时为Enum_End
+		BitBoard bbAfter;//移动后、生成数字前的局面
+		uint32_t u32Score;//这一步的合并得分
+		float fValue;//bbAfter的估值
+	};
+
+private:
+	//元组里下标连续的一段格子：(棋盘 >> u8Shift) & u64Mask，放到权重下标的第u8Dest位
+	struct Segment
+	{
+		uint64_t u64Mask;
+		uint8_t u8Shift;
+		uint8_t u8Dest;
+	};
+
+	struct Layout
+	{
+		uint64_t u64Offset;//这个元组的权重表在数组中的起始位置
+		uint8_t u8Segments;
+		Segment sgArr[szMaxTupleCells];
+	};
+
+	std::vector<Tuple> vecTuple;
+	std::vector<Layout> vecLayout;
+	uint64_t u64WeightCount;
+	uint64_t u64GamesTrained;
+
+	//可写的权重按大页对齐分配，Linux下提示内核使用透明大页：大表随机访问时TLB未命中少很多
+	struct Owned_Delete
+	{
+		void operator()(float *pData) const noexcept
+		{
+			::operator delete(pData, std::align_val_t{ szHugePage });
+		}
+	};
+
+	std::unique_ptr<float[], Owned_Delete> upOwned;//可写的权重（新建或读入内存）
+	std::unique_ptr<Replay_File> upMapped;//只读映射的存档
+	const float *pWeight;//实际使用的权重数组，指向上面两者之一
+
+private:
+	//检查元组（格子数1到7、下标不越界、不重复）并算出每个元组的分段与权重表位置
+	static bool BuildLayout(const Tuple *pTuple, size_t szCount, std::vector<Layout> &vecOut, uint64_t &u64Count)
+	{
+		vecOut.clear();
+		u64Count = 0;
+		for (size_t t = 0; t < szCount; ++t)
+		{
+			const Tuple &tpCur = pTuple[t];
+			if (tpCur.u8Size == 0 || tpCur.u8Size > szMaxTupleCells)
+			{
+				return false;
+			}
+
+			Layout lyCur{ u64Count, 0, {} };
+			uint16_t u16Used = 0;
+			for (uint8_t k = 0; k < tpCur.u8Size; ++k)
+			{
+				uint8_t u8Cell = tpCur.u8Cell[k];
+				if (u8Cell >= BitBoard::u64TotalSize || (u16Used & (1 << u8Cell)))
+				{
+					return false;
+				}
+				u16Used |= 1 << u8Cell;
+
+				//与上一格在棋盘上相邻（半字节下标连续）则接到上一段后面
+				if (k != 0 && u8Cell == tpCur.u8Cell[k - 1] + 1)
+				{
+					Segment &sgLast = lyCur.sgArr[lyCur.u8Segments - 1];
+					sgLast.u64Mask = (sgLast.u64Mask << 4) | 0xF;
+					continue;
+				}
+				lyCur.sgArr[lyCur.u8Segments++] = Segment{ 0xF, (uint8_t)(u8Cell * 4), (uint8_t)(k * 4) };
+			}
+
+			vecOut.push_back(lyCur);
+			u64Count += (uint64_t)1 << (tpCur.u8Size * 4);
+		}
+		return true;
+	}
+
+	//8个变换后的棋盘一起取下标，外层按段、内层按棋盘，内层是同一组移位与掩码，编译器可以向量化
+	//常用的元组（一行、一个方块、2*3矩形）只有一两段，单独展开
+	static void Index(const uint64_t (&u64Sym)[Board_Symmetry::u8SymCount], const Layout &lyCur, uint64_t (&u64Index)[Board_Symmetry::u8SymCount]) noexcept
+	{
+		const Segment &sg0 = lyCur.sgArr[0];
+		if (lyCur.u8Segments == 1)
+		{
+			for (uint8_t s = 0; s < Board_Symmetry::u8SymCount; ++s)
+			{
+				u64Index[s] = (u64Sym[s] >> sg0.u8Shift) & sg0.u64Mask;
+			}
+			return;
+		}
+		if (lyCur.u8Segments == 2)
+		{
+			const Segment &sg1 = lyCur.sgArr[1];
+			for (uint8_t s = 0; s < Board_Symmetry::u8SymCount; ++s)
+			{
+				u64Index[s] = ((u64Sym[s] >> sg0.u8Shift) & sg0.u64Mask) | (((u64Sym[s] >> sg1.u8Shift) & sg1.u64Mask) << sg1.u8Dest);
+			}
+			return;
+		}
+
+		for (uint8_t s = 0; s < Board_Symmetry::u8SymCount; ++s)
+		{
+			u64Index[s] = 0;
+		}
+		for (uint8_t i = 0; i < lyCur.u8Segments; ++i)
+		{
+			const Segment &sgCur = lyCur.sgArr[i];
+			for (uint8_t s = 0; s < Board_Symmetry::u8SymCount; ++s)
+			{
+				u64Index[s] |= ((u64Sym[s] >> sgCur.u8Shift) & sgCur.u64Mask) << sgCur.u8Dest;
+			}
+		}
+	}
+
+	//训练时其它线程可能正在写同一个权重
+	template<bool bShared>
+	static float LoadWeight(const float *pSrc) noexcept
+	{
+		if constexpr (bShared)
+		{
+			return std::atomic_ref<float>{ *const_cast<float *>(pSrc) }.load(std::memory_order_relaxed);
+		}
+		else
+		{
+			return *pSrc;
+		}
+	}
+
+	template<bool bShared>
+	float Sum(const BitBoard &bbBoard) const noexcept
+	{
+		uint64_t u64Sym[Board_Symmetry::u8SymCount];
+		Board_Symmetry::ApplyAll(bbBoard, u64Sym);
+
+		//每个元组的8项两两相加，几十次浮点加法不串成一条依赖链
+		float fSum = 0.0f;
+		for (const Layout &lyCur : vecLayout)
+		{
+			uint64_t u64Index[Board_Symmetry::u8SymCount];
+			Index(u64Sym, lyCur, u64Index);
+
+			const float *pTable = pWeight + lyCur.u64Offset;
+			float f0 = LoadWeight<bShared>(pTable + u64Index[0]) + LoadWeight<bShared>(pTable + u64Index[1]);
+			float f1 = LoadWeight<bShared>(pTable + u64Index[2]) + LoadWeight<bShared>(pTable + u64Index[3]);
+			float f2 = LoadWeight<bShared>(pTable + u64Index[4]) + LoadWeight<bShared>(pTable + u64Index[5]);
+			float f3 = LoadWeight<bShared>(pTable + u64Index[6]) + LoadWeight<bShared>(pTable + u64Index[7]);
+			fSum += (f0 + f1) + (f2 + f3);
+		}
+		return fSum;
+	}
+
+	//按u64WeightCount重新分配，内容未初始化；大页提示要在第一次写入之前给出
+	void AllocateOwned(void)
+	{
+		upOwned.reset();
+		size_t szBytes = (size_t)u64WeightCount * sizeof(float);
+		upOwned.reset((float *)::operator new(szBytes == 0 ? sizeof(float) : szBytes, std::align_val_t{ szHugePage }));
+#ifdef __linux__
+		if (szBytes >= szHugePage)
+		{
+			madvise(upOwned.get(), szBytes / szHugePage * szHugePage, MADV_HUGEPAGE);
+		}
+#endif
+	}
+
+	//4个方向一次批量移动，再逐个估值
+	template<bool bShared>
+	Decision Decide(const BitBoard &bbBoard) const noexcept
+	{
+		constexpr const static Direction dAll[Direction::Enum_End] = { Up, Dn, Lt, Rt };
+		const BitBoard bbSrc[Direction::Enum_End] = { bbBoard, bbBoard, bbBoard, bbBoard };
+		BitBoard bbMoved[Direction::Enum_End];
+		uint32_t u32Score[Direction::Enum_End];
+		uint64_t u64Moved = Batch_Move::Move(bbSrc, dAll, bbMoved, u32Score, Direction::Enum_End);
+
+		Decision dcRet{ Direction::Enum_End, bbBoard, 0, 0.0f };
+		float fBest = 0.0f;
+		for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+		{
+			if (!(u64Moved & ((uint64_t)1 << d)))
+			{
+				continue;
+			}
+
+			float fValue = Sum<bShared>(bbMoved[d]);
+			float fTotal = (float)u32Score[d] + fValue;
+			if (dcRet.dBest == Direction::Enum_End || fTotal > fBest)
+			{
+				fBest = fTotal;
+				dcRet = Decision{ (Direction)d, bbMoved[d], u32Score[d], fValue };
+			}
+		}
+		return dcRet;
+	}
+
+public:
+	//没有元组，估值恒为0，之后用Load读入存档
+	NTuple_Network(void) :
+		vecTuple(),
+		vecLayout(),
+		u64WeightCount(0),
+		u64GamesTrained(0),
+		upOwned(),
+		upMapped(),
+		pWeight(NULL)
+	{}
+	explicit NTuple_Network(Tuple_Set enSet) : NTuple_Network()
+	{
+		const std::vector<Tuple> &vecPreset = Preset(enSet);
+		SetTuples(vecPreset.data(), vecPreset.size());
+	}
+	~NTuple_Network(void) = default;
+
+	NTuple_Network(const NTuple_Network &) = delete;
+	NTuple_Network &operator=(const NTuple_Network &) = delete;
+
+	//常用的元组组合，每个元组在8个对称变换下覆盖整个棋盘
+	static const std::vector<Tuple> &Preset(Tuple_Set enSet)
+	{
+		static const std::vector<Tuple> vecSmall =
+		{
+			{ 4, { 0, 1, 2, 3 } },//边上一行
+			{ 4, { 4, 5, 6, 7 } },//第二行
+			{ 4, { 0, 1, 4, 5 } },//角上的方块
+			{ 4, { 1, 2, 5, 6 } },//边上的方块
+			{ 4, { 5, 6, 9, 10 } },//中间的方块
+		};
+		static const std::vector<Tuple> vecLarge =
+		{
+			{ 6, { 0, 1, 2, 3, 4, 5 } },
+			{ 6, { 4, 5, 6, 7, 8, 9 } },
+			{ 6, { 0, 1, 2, 4, 5, 6 } },
+			{ 6, { 4, 5, 6, 8, 9, 10 } },
+		};
+		return enSet == Large ? vecLarge : vecSmall;
+	}
+
+	//换成新的元组，权重全部清零；元组不合法时返回false且不改变网络
+	bool SetTuples(const Tuple *pTuple, size_t szCount)
+	{
+		std::vector<Layout> vecNewLayout;
+		uint64_t u64NewCount = 0;
+		if (!BuildLayout(pTuple, szCount, vecNewLayout, u64NewCount))
+		{
+			return false;
+		}
+
+		vecTuple.assign(pTuple, pTuple + szCount);
+		vecLayout = std::move(vecNewLayout);
+		u64WeightCount = u64NewCount;
+		u64GamesTrained = 0;
+
+		upMapped.reset();
+		AllocateOwned();
+		memset(upOwned.get(), 0, (size_t)u64WeightCount * sizeof(float));
+		pWeight = upOwned.get();
+		return true;
+	}
+
+	//读入存档，bMap为true时只读映射（只能估值），否则拷贝进可写的内存（可以继续训练）
+	//文件不存在或格式不对时返回false且不改变网络
+	bool Load(const char *pPath, bool bMap)
+	{
+		std::unique_ptr<Replay_File> upFile = std::make_unique<Replay_File>();
+		if (!upFile->Open(pPath, false) || upFile->Size() < szHeaderSize)
+		{
+			return false;
+		}
+
+		const uint8_t *pData = upFile->Data();
+		size_t szSize = upFile->Size();
+		uint32_t u32TupleCount = Replay_Format::Load<uint32_t>(pData + 12);
+		uint64_t u64Count = Replay_Format::Load<uint64_t>(pData + 16);
+		uint64_t u64Offset = Replay_Format::Load<uint64_t>(pData + 24);
+		if (memcmp(pData, cMagic, sizeof(cMagic)) != 0 ||
+			Replay_Format::Load<uint32_t>(pData + 8) != u32Version ||
+			u64Offset % szWeightAlign != 0 ||
+			u64Offset < szHeaderSize + (uint64_t)u32TupleCount * szTupleBytes ||
+			u64Offset > szSize ||
+			u64Count > (szSize - u64Offset) / sizeof(float))
+		{
+			return false;
+		}
+
+		std::vector<Tuple> vecNewTuple(u32TupleCount);
+		for (uint32_t t = 0; t < u32TupleCount; ++t)
+		{
+			const uint8_t *pTuple = pData + szHeaderSize + (size_t)t * szTupleBytes;
+			vecNewTuple[t].u8Size = pTuple[0];
+			memcpy(vecNewTuple[t].u8Cell, pTuple + 1, szMaxTupleCells);
+		}
+
+		std::vector<Layout> vecNewLayout;
+		uint64_t u64NewCount = 0;
+		if (!BuildLayout(vecNewTuple.data(), vecNewTuple.size(), vecNewLayout, u64NewCount) || u64NewCount != u64Count)
+		{
+			return false;
+		}
+
+		vecTuple = std::move(vecNewTuple);
+		vecLayout = std::move(vecNewLayout);
+		u64WeightCount = u64Count;
+		u64GamesTrained = Replay_Format::Load<uint64_t>(pData + 32);
+
+		const float *pFileWeight = (const float *)(pData + u64Offset);
+		if (bMap)
+		{
+			upOwned.reset();
+			upMapped = std::move(upFile);
+			pWeight = pFileWeight;
+		}
+		else
+		{
+			AllocateOwned();
+			memcpy(upOwned.get(), pFileWeight, (size_t)u64WeightCount * sizeof(float));
+			upMapped.reset();
+			pWeight = upOwned.get();
+		}
+		return true;
+	}
+
+	//先写入临时文件再改名，写到一半中断时原来的存档仍然完整
+	//可以与训练同时进行，权重逐个relaxed读取，存下的是训练过程中某一刻附近的快照
+	bool Save(const char *pPath) const
+	{
+		std::string strTemp = std::string{ pPath } + ".tmp";
+		FILE *fp = fopen(strTemp.c_str(), "wb");
+		if (fp == NULL)
+		{
+			return false;
+		}
+
+		uint64_t u64Offset = (szHeaderSize + vecTuple.size() * szTupleBytes + szWeightAlign - 1) / szWeightAlign * szWeightAlign;
+		std::vector<uint8_t> vecHeader((size_t)u64Offset, 0);
+		memcpy(vecHeader.data(), cMagic, sizeof(cMagic));
+		Replay_Format::Store<uint32_t>(vecHeader.data() + 8, u32Version);
+		Replay_Format::Store<uint32_t>(vecHeader.data() + 12, (uint32_t)vecTuple.size());
+		Replay_Format::Store<uint64_t>(vecHeader.data() + 16, u64WeightCount);
+		Replay_Format::Store<uint64_t>(vecHeader.data() + 24, u64Offset);
+		Replay_Format::Store<uint64_t>(vecHeader.data() + 32, u64GamesTrained);
+		for (size_t t = 0; t < vecTuple.size(); ++t)
+		{
+			uint8_t *pTuple = vecHeader.data() + szHeaderSize + t * szTupleBytes;
+			pTuple[0] = vecTuple[t].u8Size;
+			memcpy(pTuple + 1, vecTuple[t].u8Cell, szMaxTupleCells);
+		}
+		bool bRet = fwrite(vecHeader.data(), 1, vecHeader.size(), fp) == vecHeader.size();
+
+		float fBuf[16384];
+		for (uint64_t u64Beg = 0; bRet && u64Beg < u64WeightCount; u64Beg += std::size(fBuf))
+		{
+			size_t szChunk = (size_t)(u64WeightCount - u64Beg < std::size(fBuf) ? u64WeightCount - u64Beg : std::size(fBuf));
+			for (size_t i = 0; i < szChunk; ++i)
+			{
+				fBuf[i] = LoadWeight<true>(pWeight + u64Beg + i);
+			}
+			bRet = fwrite(fBuf, sizeof(float), szChunk, fp) == szChunk;
+		}
+
+		bRet = fclose(fp) == 0 && bRet;
+#ifdef _WIN32
+		bRet = bRet && (remove(pPath) == 0 || errno == ENOENT);//Windows下rename不覆盖已有文件
+#endif
+		bRet = bRet && rename(strTemp.c_str(), pPath) == 0;
+		if (!bRet)
+		{
+			remove(strTemp.c_str());
+		}
+		return bRet;
+	}
+
+	//====================估值====================
+	//没有其它线程在写权重时使用
+	float Evaluate(const BitBoard &bbBoard) const noexcept
+	{
+		return Sum<false>(bbBoard);
+	}
+
+	//训练过程中使用，可以与Update同时进行
+	float EvaluateShared(const BitBoard &bbBoard) const noexcept
+	{
+		return Sum<true>(bbBoard);
+	}
+
+	Decision BestMove(const BitBoard &bbBoard) const noexcept
+	{
+		return Decide<false>(bbBoard);
+	}
+
+	Decision BestMoveShared(const BitBoard &bbBoard) const noexcept
+	{
+		return Decide<true>(bbBoard);
+	}
+
+	//====================训练====================
+	//局面涉及的每个权重（每个元组、每个对称变换各一个）都加上fDelta，估值因此变化约FeatureCount() * fDelta
+	//不加锁，多个线程可以同时调用；只读映射的网络不能调用
+	void Update(const BitBoard &bbBoard, float fDelta) noexcept
+	{
+		uint64_t u64Sym[Board_Symmetry::u8SymCount];
+		Board_Symmetry::ApplyAll(bbBoard, u64Sym);
+
+		float *pBase = upOwned.get();
+		for (const Layout &lyCur : vecLayout)
+		{
+			uint64_t u64Index[Board_Symmetry::u8SymCount];
+			Index(u64Sym, lyCur, u64Index);
+
+			float *pTable = pBase + lyCur.u64Offset;
+			for (uint64_t u64Cur : u64Index)
+			{
+				std::atomic_ref<float> arWeight{ pTable[u64Cur] };
+				arWeight.store(arWeight.load(std::memory_order_relaxed) + fDelta, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool Writable(void) const noexcept
+	{
+		return !upMapped;
+	}
+
+	uint64_t FeatureCount(void) const noexcept
+	{
+		return (uint64_t)vecLayout.size() * Board_Symmetry::u8SymCount;
+	}
+
+	uint64_t WeightCount(void) const noexcept
+	{
+		return u64WeightCount;
+	}
+
+	const std::vector<Tuple> &GetTuples(void) const noexcept
+	{
+		return vecTuple;
+	}
+
+	uint64_t GetGamesTrained(void) const noexcept
+	{
+		return u64GamesTrained;
+	}
+
+	void SetGamesTrained(uint64_t _u64GamesTrained) noexcept
+	{
+		u64GamesTrained = _u64GamesTrained;
+	}
+};
+
+/*
+N元组网络的自我对弈训练（时间差分学习，学习的是移动后局面的估值）:
+
+每一步选择 得分 + 移动后局面估值 最大的方向（不需要额外的探索，生成数字本身足够随机）
+λ为0时逐步更新（TD(0)）：上一个移动后局面的估值向 这一步得分 + 这一步移动后局面的估值 靠拢，无路可走时目标为0
+λ大于0时记下整局的移动后局面，结束后从最后一步往前按λ回报更新：
+	G(t) = r(t+1) + (1 - λ) * V(t+1) + λ * G(t+1)，最后一个局面的G为0
+学习率α是每次更新把估值向目标移动的比例，平均分到局面涉及的每个权重上
+多个线程各自按局号领取任务、自我对弈，同时更新同一个网络，不加锁（见NTuple_Network）
+每局使用由(主种子, 局号)派生的随机数流；只有一个线程时训练结果可以复现，多线程时取决于调度
+*/
+class NTuple_Trainer
+{
+public:
+	struct Config
+	{
+		uint64_t u64Games = 100000;//总局数
+		uint64_t u64Threads = 0;//线程数，0代表使用所有核心
+		uint64_t u64Seed = 0;//主种子
+		double dAlpha = 0.1;//学习率
+		double dLambda = 0.0;//λ
+		uint64_t u64ReportInterval = 10000;//每训练这么多局输出一次进度，并在指定了存档时写一次存档
+		double dSpawnWeights_2 = 0.9;//生成2的权重
+		double dSpawnWeights_4 = 0.1;//生成4的权重
+		const char *pOutputPath = NULL;//存档路径，为NULL时不写存档
+	};
+
+	struct Result
+	{
+		uint64_t u64Games = 0;//完成的局数
+		uint64_t u64Moves = 0;//总移动次数
+		uint64_t u64TotalScore = 0;//总得分
+		uint64_t u64MaxScore = 0;//单局最高得分
+		uint64_t u64Wins = 0;//达到2048的局数
+
+		void Merge(const Result &_Right) noexcept
+		{
+			u64Games += _Right.u64Games;
+			u64Moves += _Right.u64Moves;
+			u64TotalScore += _Right.u64TotalScore;
+			u64MaxScore = _Right.u64MaxScore > u64MaxScore ? _Right.u64MaxScore : u64MaxScore;
+			u64Wins += _Right.u64Wins;
+		}
+	};
+
+private:
+	constexpr const static inline uint8_t u8WinExp = 11;//2048的指数
+
+	//所有线程共用的进度，只在每局结束时更新一次
+	struct Progress
+	{
+		std::atomic<uint64_t> atNextGame{ 0 };
+		std::atomic<uint64_t> atDoneGames{ 0 };
+		std::atomic<uint64_t> atWindowGames{ 0 };//上次输出进度以来的局数、得分与达到2048的局数
+		std::atomic<uint64_t> atWindowScore{ 0 };
+		std::atomic<uint64_t> atWindowWins{ 0 };
+		std::mutex mtxReport;//输出进度与写存档
+		std::chrono::steady_clock::time_point tpBeg = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point tpReport = tpBeg;
+		uint64_t u64BaseGames = 0;//存档里原来已经训练过的局数
+	};
+
+	//λ回报需要的一步：移动后的局面与得到它的那一步的得分
+	struct TraceStep
+	{
+		BitBoard bbAfter;
+		uint32_t u32Score;
+	};
+
+	class Worker
+	{
+	private:
+		const Config &cfgTrain;
+		NTuple_Network &ntNetwork;
+		Progress &pgShared;
+
+		float fStep;//每个权重的更新量 = fStep * 误差
+		uint64_t u64Spawn4Threshold;
+		std::vector<TraceStep> vecTrace;//本局的移动后局面，λ大于0时才使用
+
+		Result resLocal;
+
+	private:
+		//与Game2048_Engine::SpawnRandomTile相同：先选空格再选数字
+		void SpawnRandomTile(BitBoard &bbBoard, Rand_Counter &randGame) const noexcept
+		{
+			uint64_t u64Index = bbBoard.PickEmpty([&randGame](uint64_t u64EmptyCount) -> uint64_t
+			{
+				return randGame.Below(u64EmptyCount);
+			});
+			if (u64Index == BitBoard::u64TotalSize)
+			{
+				return;
+			}
+			bbBoard.SetExp(u64Index, randGame.Next() < u64Spawn4Threshold ? 2 : 1);
+		}
+
+		void Learn(const BitBoard &bbAfter, float fTarget) noexcept
+		{
+			ntNetwork.Update(bbAfter, fStep * (fTarget - ntNetwork.EvaluateShared(bbAfter)));
+		}
+
+		//从最后一步往前，用更新之前的估值计算λ回报
+		void LearnTrace(void) noexcept
+		{
+			float fLambda = (float)cfgTrain.dLambda;
+			float fReturn = 0.0f;//G(t+1)
+			float fNextValue = 0.0f;//V(t+1)
+			float fNextScore = 0.0f;//r(t+1)
+			for (size_t t = vecTrace.size(); t-- > 0;)
+			{
+				fReturn = fNextScore + (1.0f - fLambda) * fNextValue + fLambda * fReturn;
+
+				float fValue = ntNetwork.EvaluateShared(vecTrace[t].bbAfter);
+				ntNetwork.Update(vecTrace[t].bbAfter, fStep * (fReturn - fValue));
+				fNextValue = fValue;
+				fNextScore = (float)vecTrace[t].u32Score;
+			}
+			vecTrace.clear();
+		}
+
+		void PlayOne(uint64_t u64GameIndex)
+		{
+			Rand_Counter randGame = Rand_Counter::Stream(cfgTrain.u64Seed, u64GameIndex);
+			BitBoard bbBoard{};
+			SpawnRandomTile(bbBoard, randGame);
+			SpawnRandomTile(bbBoard, randGame);
+
+			bool bTrace = cfgTrain.dLambda > 0.0;
+			bool bHasLast = false;
+			BitBoard bbLastAfter{};
+			uint64_t u64Score = 0;
+			uint64_t u64Moves = 0;
+			while (true)
+			{
+				NTuple_Network::Decision dcCur = ntNetwork.BestMoveShared(bbBoard);
+				bool bEnd = dcCur.dBest == Direction::Enum_End;
+				if (!bTrace && bHasLast)
+				{
+					Learn(bbLastAfter, bEnd ? 0.0f : (float)dcCur.u32Score + dcCur.fValue);
+				}
+				if (bEnd)//无路可走，本局结束
+				{
+					break;
+				}
+
+				if (bTrace)
+				{
+					vecTrace.push_back(TraceStep{ dcCur.bbAfter, dcCur.u32Score });
+				}
+				bHasLast = true;
+				bbLastAfter = dcCur.bbAfter;
+
+				u64Score += dcCur.u32Score;
+				++u64Moves;
+				bbBoard = dcCur.bbAfter;
+				SpawnRandomTile(bbBoard, randGame);
+			}
+
+			if (bTrace)
+			{
+				LearnTrace();
+			}
+
+			bool bWin = bbBoard.MaxExp() >= u8WinExp;
+			++resLocal.u64Games;
+			resLocal.u64Moves += u64Moves;
+			resLocal.u64TotalScore += u64Score;
+			resLocal.u64MaxScore = u64Score > resLocal.u64MaxScore ? u64Score : resLocal.u64MaxScore;
+			resLocal.u64Wins += bWin;
+
+			pgShared.atWindowGames.fetch_add(1, std::memory_order_relaxed);
+			pgShared.atWindowScore.fetch_add(u64Score, std::memory_order_relaxed);
+			pgShared.atWindowWins.fetch_add(bWin, std::memory_order_relaxed);
+			uint64_t u64Done = pgShared.atDoneGames.fetch_add(1, std::memory_order_relaxed) + 1;
+			if (cfgTrain.u64ReportInterval != 0 && u64Done % cfgTrain.u64ReportInterval == 0 && u64Done != cfgTrain.u64Games)
+			{
+				Report(cfgTrain, ntNetwork, pgShared, u64Done);
+			}
+		}
+
+	public:
+		Worker(const Config &_cfgTrain, NTuple_Network &_ntNetwork, Progress &_pgShared) :
+			cfgTrain(_cfgTrain),
+			ntNetwork(_ntNetwork),
+			pgShared(_pgShared),
+			fStep((float)(_cfgTrain.dAlpha / (double)(_ntNetwork.FeatureCount() == 0 ? 1 : _ntNetwork.FeatureCount()))),
+			u64Spawn4Threshold(Game2048_Random::ProbToThreshold(_cfgTrain.dSpawnWeights_4 / (_cfgTrain.dSpawnWeights_2 + _cfgTrain.dSpawnWeights_4))),
+			vecTrace(),
+			resLocal()
+		{}
+		~Worker(void) = default;
+
+		//不断领取局号直到全部领完
+		void Run(void)
+		{
+			while (true)
+			{
+				uint64_t u64GameIndex = pgShared.atNextGame.fetch_add(1, std::memory_order_relaxed);
+				if (u64GameIndex >= cfgTrain.u64Games)
+				{
+					break;
+				}
+				PlayOne(u64GameIndex);
+			}
+		}
+
+		const Result &GetResult(void) const noexcept
+		{
+			return resLocal;
+		}
+	};
+
+private:
+	//输出上次以来的平均得分与达到2048的比例，并写一次存档（其它线程继续训练）
+	static void Report(const Config &cfgTrain, NTuple_Network &ntNetwork, Progress &pgShared, uint64_t u64Done)
+	{
+		std::lock_guard<std::mutex> lgReport{ pgShared.mtxReport };
+		uint64_t u64Games = pgShared.atWindowGames.exchange(0, std::memory_order_relaxed);
+		uint64_t u64Score = pgShared.atWindowScore.exchange(0, std::memory_order_relaxed);
+		uint64_t u64Wins = pgShared.atWindowWins.exchange(0, std::memory_order_relaxed);
+
+		auto tpNow = std::chrono::steady_clock::now();
+		double dSeconds = std::chrono::duration<double>(tpNow - pgShared.tpReport).count();
+		pgShared.tpReport = tpNow;
+
+		printf("progress games=%llu score_mean=%.2f win_rate=%.4f games_per_second=%.1f\n",
+			(unsigned long long)u64Done,
+			u64Games == 0 ? 0.0 : (double)u64Score / (double)u64Games,
+			u64Games == 0 ? 0.0 : (double)u64Wins / (double)u64Games,
+			dSeconds > 0.0 ? (double)u64Games / dSeconds : 0.0);
+		fflush(stdout);
+
+		if (cfgTrain.pOutputPath != NULL)
+		{
+			ntNetwork.SetGamesTrained(pgShared.u64BaseGames + u64Done);
+			if (!ntNetwork.Save(cfgTrain.pOutputPath))
+			{
+				fprintf(stderr, "Error: cannot write checkpoint %s\n", cfgTrain.pOutputPath);
+			}
+		}
+	}
+
+public:
+	//训练结束时写最终存档
+	static Result Run(const Config &cfgTrain, NTuple_Network &ntNetwork)
+	{
+		uint64_t u64Threads = cfgTrain.u64Threads;
+		if (u64Threads == 0)
+		{
+			u64Threads = std::thread::hardware_concurrency();
+			u64Threads = u64Threads == 0 ? 1 : u64Threads;
+		}
+
+		Progress pgShared{};
+		pgShared.u64BaseGames = ntNetwork.GetGamesTrained();
+
+		std::vector<Result> vecResult(u64Threads);
+		std::vector<std::thread> vecThread;
+		vecThread.reserve(u64Threads);
+		for (uint64_t i = 0; i < u64Threads; ++i)
+		{
+			vecThread.emplace_back([&, i](void) -> void
+			{
+				Worker wkThread{ cfgTrain, ntNetwork, pgShared };
+				wkThread.Run();
+				vecResult[i] = wkThread.GetResult();
+			});
+		}
+
+		Result resTotal{};
+		for (uint64_t i = 0; i < u64Threads; ++i)
+		{
+			vecThread[i].join();
+			resTotal.Merge(vecResult[i]);
+		}
+
+		ntNetwork.SetGamesTrained(pgShared.u64BaseGames + resTotal.u64Games);
+		if (cfgTrain.pOutputPath != NULL && !ntNetwork.Save(cfgTrain.pOutputPath))
+		{
+			fprintf(stderr, "Error: cannot write checkpoint %s\n", cfgTrain.pOutputPath);
+		}
+
+		return resTotal;
+	}
+
+	//命令行入口：game2048 --train <games> [--tuples small|large] [--init FILE] [--out FILE] [--threads N] [--seed S] [--alpha A] [--lambda L] [--report N]
+	static int Main(int argc, char *argv[])
+	{
+		auto Usage = [&](void) -> int
+		{
+			fprintf(stderr, "Usage: %s --train <games> [--tuples small|large] [--init FILE] [--out FILE] [--threads N] [--seed S] [--alpha A] [--lambda L] [--report N]\n", argv[0]);
+			return 1;
+		};
+
+		if (argc < 3)
+		{
+			return Usage();
+		}
+
+		Config cfgTrain{};
+		cfgTrain.u64Games = strtoull(argv[2], NULL, 10);
+		cfgTrain.u64Seed = std::random_device{}();
+
+		NTuple_Network::Tuple_Set enSet = NTuple_Network::Small;
+		const char *pInitPath = NULL;
+		for (int i = 3; i < argc; i += 2)
+		{
+			if (i + 1 >= argc)
+			{
+				return Usage();
+			}
+
+			const char *pArg = argv[i];
+			const char *pValue = argv[i + 1];
+			if (strcmp(pArg, "--tuples") == 0)
+			{
+				if (strcmp(pValue, "small") == 0)
+				{
+					enSet = NTuple_Network::Small;
+				}
+				else if (strcmp(pValue, "large") == 0)
+				{
+					enSet = NTuple_Network::Large;
+				}
+				else
+				{
+					return Usage();
+				}
+			}
+			else if (strcmp(pArg, "--init") == 0)//从已有存档继续训练，元组以存档为准
+			{
+				pInitPath = pValue;
+			}
+			else if (strcmp(pArg, "--out") == 0)
+			{
+				cfgTrain.pOutputPath = pValue;
+			}
+			else if (strcmp(pArg, "--threads") == 0)
+			{
+				cfgTrain.u64Threads = strtoull(pValue, NULL, 10);
+			}
+			else if (strcmp(pArg, "--seed") == 0)
+			{
+				cfgTrain.u64Seed = strtoull(pValue, NULL, 10);
+			}
+			else if (strcmp(pArg, "--alpha") == 0)
+			{
+				cfgTrain.dAlpha = strtod(pValue, NULL);
+				if (!(cfgTrain.dAlpha > 0.0))
+				{
+					return Usage();
+				}
+			}
+			else if (strcmp(pArg, "--lambda") == 0)
+			{
+				cfgTrain.dLambda = strtod(pValue, NULL);
+				if (!(cfgTrain.dLambda >= 0.0 && cfgTrain.dLambda <= 1.0))
+				{
+					return Usage();
+				}
+			}
+			else if (strcmp(pArg, "--report") == 0)
+			{
+				cfgTrain.u64ReportInterval = strtoull(pValue, NULL, 10);
+			}
+			else
+			{
+				return Usage();
+			}
+		}
+
+		NTuple_Network ntNetwork{};
+		if (pInitPath != NULL)
+		{
+			if (!ntNetwork.Load(pInitPath, false))
+			{
+				fprintf(stderr, "Error: cannot load checkpoint %s\n", pInitPath);
+				return 1;
+			}
+		}
+		else
+		{
+			ntNetwork.SetTuples(NTuple_Network::Preset(enSet).data(), NTuple_Network::Preset(enSet).size());
+		}
+
+		auto tpBeg = std::chrono::steady_clock::now();
+		Result resTotal = Run(cfgTrain, ntNetwork);
+		auto tpEnd = std::chrono::steady_clock::now();
+		double dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+
+		//以key=value形式输出，方便脚本解析
+		printf("seed=%llu\n", (unsigned long long)cfgTrain.u64Seed);
+		printf("tuples=%llu\n", (unsigned long long)ntNetwork.GetTuples().size());
+		printf("weights=%llu\n", (unsigned long long)ntNetwork.WeightCount());
+		printf("games=%llu\n", (unsigned long long)resTotal.u64Games);
+		printf("games_trained=%llu\n", (unsigned long long)ntNetwork.GetGamesTrained());
+		printf("moves=%llu\n", (unsigned long long)resTotal.u64Moves);
+		printf("score_mean=%.2f\n", resTotal.u64Games == 0 ? 0.0 : (double)resTotal.u64TotalScore / (double)resTotal.u64Games);
+		printf("score_max=%llu\n", (unsigned long long)resTotal.u64MaxScore);
+		printf("wins=%llu\n", (unsigned long long)resTotal.u64Wins);
+		printf("seconds=%.3f\n", dSeconds);
+		printf("moves_per_second=%.1f\n", dSeconds > 0.0 ? (double)resTotal.u64Moves / dSeconds : 0.0);
+		return 0;
+	}
+};
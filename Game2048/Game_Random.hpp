@@ -0,0 +1,172 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+随机数生成策略:
+
+引擎通过模板参数选择随机数生成器，要求提供：
+	uint64_t Next(void)                              下一个64bit均匀随机数
+	uint64_t Below(uint64_t n)                       [0, n)内的均匀随机数
+	static X Stream(uint64_t u64Seed, uint64_t u64Stream)  由主种子派生第u64Stream条独立的流
+
+同一个主种子派生出的流互不相关，并行时每个线程（或每局）各取一条，
+结果与线程数、调度顺序无关，可以逐位复现
+*/
+
+namespace Game2048_Random
+{
+	//SplitMix64的输出混合函数，双射
+	constexpr uint64_t Mix64(uint64_t z) noexcept
+	{
+		z = (z ^ (z >> 30)) * 0xBF58'476D'1CE4'E5B9;
+		z = (z ^ (z >> 27)) * 0x94D0'49BB'1331'11EB;
+		return z ^ (z >> 31);
+	}
+
+	//64*64乘法的高64位
+	inline uint64_t MulHi64(uint64_t a, uint64_t b) noexcept
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		return __umulh(a, b);
+#else
+		return (uint64_t)(((unsigned __int128)a * b) >> 64);
+#endif
+	}
+
+	//由主种子与流编号得到一个流密钥
+	constexpr uint64_t StreamKey(uint64_t u64Seed, uint64_t u64Stream) noexcept
+	{
+		return Mix64(u64Seed ^ Mix64(u64Stream + 0x9E37'79B9'7F4A'7C15));
+	}
+
+	//把[0,1]的概率转换成64bit阈值，Next() < 阈值的概率即为该概率
+	constexpr uint64_t ProbToThreshold(double dProb) noexcept
+	{
+		if (dProb <= 0.0)
+		{
+			return 0;
+		}
+		if (dProb >= 1.0)
+		{
+			return UINT64_MAX;
+		}
+		return (uint64_t)(dProb * 18446744073709551616.0);//2^64
+	}
+}
+
+/*
+基于计数器的生成器:
+
+第n个输出 = 以流密钥为参数的混合函数(n)，状态只有(密钥, 计数器)共16字节
+计数器就是当前位置，可以任意跳转（撤销、回放时只需记录计数器）
+*/
+class Rand_Counter
+{
+private:
+	uint64_t u64Key;//流密钥
+	uint64_t u64Counter;//已经取出的随机数个数
+
+public:
+	constexpr Rand_Counter(uint64_t u64Seed = 0) noexcept :
+		u64Key(Game2048_Random::StreamKey(u64Seed, 0)),
+		u64Counter(0)
+	{}
+	~Rand_Counter(void) = default;
+
+	constexpr static Rand_Counter Stream(uint64_t u64Seed, uint64_t u64Stream) noexcept
+	{
+		Rand_Counter rcRet{};
+		rcRet.u64Key = Game2048_Random::StreamKey(u64Seed, u64Stream);
+		return rcRet;
+	}
+
+	constexpr uint64_t Next(void) noexcept
+	{
+		//两轮带密钥的混合，同一条流内计数器不同则输出不同
+		return Game2048_Random::Mix64(Game2048_Random::Mix64(u64Counter++ ^ u64Key) ^ u64Key);
+	}
+
+	//乘法取高位，不做除法；偏差不超过n/2^64，对棋盘大小的n可以忽略
+	uint64_t Below(uint64_t n) noexcept
+	{
+		return Game2048_Random::MulHi64(Next(), n);
+	}
+
+	constexpr uint64_t GetPosition(void) const noexcept
+	{
+		return u64Counter;
+	}
+
+	constexpr void SetPosition(uint64_t _u64Counter) noexcept
+	{
+		u64Counter = _u64Counter;
+	}
+};
+
+/*
+xoshiro256++:
+
+状态32字节，单次生成只需要几次移位、异或与加法
+每条流的初始状态由流密钥经SplitMix64展开得到
+*/
+class Rand_Xoshiro256pp
+{
+private:
+	uint64_t u64State[4];
+
+private:
+	constexpr static uint64_t Rotl(uint64_t x, int k) noexcept
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+
+	constexpr void SeedFromKey(uint64_t u64Key) noexcept
+	{
+		for (auto &it : u64State)
+		{
+			u64Key += 0x9E37'79B9'7F4A'7C15;
+			it = Game2048_Random::Mix64(u64Key);
+		}
+	}
+
+public:
+	constexpr Rand_Xoshiro256pp(uint64_t u64Seed = 0) noexcept : u64State{}
+	{
+		SeedFromKey(Game2048_Random::StreamKey(u64Seed, 0));
+	}
+	~Rand_Xoshiro256pp(void) = default;
+
+	constexpr static Rand_Xoshiro256pp Stream(uint64_t u64Seed, uint64_t u64Stream) noexcept
+	{
+		Rand_Xoshiro256pp rxRet{};
+		rxRet.SeedFromKey(Game2048_Random::StreamKey(u64Seed, u64Stream));
+		return rxRet;
+	}
+
+	constexpr uint64_t Next(void) noexcept
+	{
+		uint64_t u64Ret = Rotl(u64State[0] + u64State[3], 23) + u64State[0];
+		uint64_t t = u64State[1] << 17;
+
+		u64State[2] ^= u64State[0];
+		u64State[3] ^= u64State[1];
+		u64State[1] ^= u64State[2];
+		u64State[0] ^= u64State[3];
+
+		u64State[2] ^= t;
+		u64State[3] = Rotl(u64State[3], 45);
+
+		return u64Ret;
+	}
+
+	uint64_t Below(uint64_t n) noexcept
+	{
+		return Game2048_Random::MulHi64(Next(), n);
+	}
+};
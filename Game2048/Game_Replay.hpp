@@ -0,0 +1,568 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#ifdef _WIN32
+#include <stdlib.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "Game_Engine.hpp"
+
+/*
+回放格式:
+
+一个回放文件是若干条记录首尾相接，每条记录 = 64字节头 + 移动流，所有整数按小端序存储
+	偏移  类型      内容
+	0     char[4]   魔数"G2RP"
+	4     uint8     版本号
+	5     uint8     棋盘宽
+	6     uint8     棋盘高
+	7     uint8     保留，写0
+	8     uint64    主种子
+	16    uint64    随机数流编号（Rand_Counter::Stream的第二个参数，交互模式为0）
+	24    uint64    开局（Reset之前）随机数生成器的位置
+	32    double    生成2的权重
+	40    double    生成4的权重
+	48    uint64    移动次数n
+	56    uint64    记录者声明的最终得分
+	64    uint8[]   移动流，每个方向2bit，每字节从低位起依次存4步，共(n+3)/4字节
+
+只记录真正改变了棋盘的移动，由(种子, 流, 位置, 权重)即可重建引擎并逐步重放
+赢了之后如果还有后续移动，重放时先调用ContinueAfterWin再继续（与批量模拟一致）
+*/
+class Replay_Format
+{
+public:
+	constexpr const static inline char cMagic[4] = { 'G', '2', 'R', 'P' };
+	constexpr const static inline uint8_t u8Version = 1;
+	constexpr const static inline size_t szHeaderSize = 64;
+	constexpr const static inline double dCanonicalWeights_2 = 0.9;//记录者（交互、批量模拟）都使用的生成权重
+	constexpr const static inline double dCanonicalWeights_4 = 0.1;
+
+	constexpr static size_t MoveBytes(uint64_t u64MoveCount) noexcept
+	{
+		return (size_t)((u64MoveCount + 3) / 4);
+	}
+
+	//主机为小端序（x86、ARM），直接按字节拷贝
+	template<typename T>
+	static void Store(uint8_t *pDst, T tValue) noexcept
+	{
+		memcpy(pDst, &tValue, sizeof(T));
+	}
+
+	//权重来自不可信的文件：必须有限、非负且和为正，否则算概率时得到NaN或负数
+	static bool ValidWeights(double dSpawnWeights_2, double dSpawnWeights_4) noexcept
+	{
+		return isfinite(dSpawnWeights_2) && isfinite(dSpawnWeights_4) &&
+			dSpawnWeights_2 >= 0.0 && dSpawnWeights_4 >= 0.0 &&
+			dSpawnWeights_2 + dSpawnWeights_4 > 0.0;
+	}
+
+	static bool CanonicalWeights(double dSpawnWeights_2, double dSpawnWeights_4) noexcept
+	{
+		return dSpawnWeights_2 == dCanonicalWeights_2 && dSpawnWeights_4 == dCanonicalWeights_4;
+	}
+
+	template<typename T>
+	static T Load(const uint8_t *pSrc) noexcept
+	{
+		T tRet;
+		memcpy(&tRet, pSrc, sizeof(T));
+		return tRet;
+	}
+};
+
+//一条记录的只读视图，指向映射的文件内容，不拷贝移动流
+struct Replay_Record
+{
+	uint64_t u64Offset;//记录在文件中的偏移
+	uint8_t u8Width;
+	uint8_t u8Height;
+	uint64_t u64Seed;
+	uint64_t u64Stream;
+	uint64_t u64Position;
+	double dSpawnWeights_2;
+	double dSpawnWeights_4;
+	uint64_t u64MoveCount;
+	uint64_t u64ClaimedScore;
+	const uint8_t *pMoves;
+
+	Direction GetMove(uint64_t u64Index) const noexcept
+	{
+		return (Direction)((pMoves[u64Index / 4] >> (u64Index % 4 * 2)) & 0x3);
+	}
+};
+
+/*
+记录器:
+
+所有记录直接序列化进一个字节缓冲区，Begin写入头部，Record按2bit追加方向，
+End回填移动次数与得分，WriteTo把缓冲区整体写入文件后清空
+*/
+class Replay_Recorder
+{
+private:
+	std::vector<uint8_t> vecBytes;//已序列化的记录
+	size_t szCurHeader;//当前记录头部在缓冲区中的偏移
+	uint64_t u64CurMoves;//当前记录已有的移动次数
+	bool bActive;//是否有未结束的记录
+
+public:
+	Replay_Recorder(void) :
+		vecBytes(),
+		szCurHeader(0),
+		u64CurMoves(0),
+		bActive(false)
+	{}
+	~Replay_Recorder(void) = default;
+
+	//开始一条新记录，u64Position为Reset之前随机数生成器的位置
+	void Begin(uint8_t u8Width, uint8_t u8Height, uint64_t u64Seed, uint64_t u64Stream, uint64_t u64Position, double dSpawnWeights_2, double dSpawnWeights_4)
+	{
+		szCurHeader = vecBytes.size();
+		u64CurMoves = 0;
+		bActive = true;
+
+		vecBytes.resize(szCurHeader + Replay_Format::szHeaderSize, 0);
+		uint8_t *pHeader = vecBytes.data() + szCurHeader;
+		memcpy(pHeader, Replay_Format::cMagic, sizeof(Replay_Format::cMagic));
+		pHeader[4] = Replay_Format::u8Version;
+		pHeader[5] = u8Width;
+		pHeader[6] = u8Height;
+		Replay_Format::Store<uint64_t>(pHeader + 8, u64Seed);
+		Replay_Format::Store<uint64_t>(pHeader + 16, u64Stream);
+		Replay_Format::Store<uint64_t>(pHeader + 24, u64Position);
+		Replay_Format::Store<double>(pHeader + 32, dSpawnWeights_2);
+		Replay_Format::Store<double>(pHeader + 40, dSpawnWeights_4);
+	}
+
+	//记录一次改变了棋盘的移动
+	void Record(Direction dMove)
+	{
+		if (!bActive)
+		{
+			return;
+		}
+
+		uint64_t u64Shift = u64CurMoves % 4 * 2;
+		if (u64Shift == 0)
+		{
+			vecBytes.push_back(0);
+		}
+		vecBytes.back() |= (uint8_t)(((uint8_t)dMove & 0x3) << u64Shift);
+		++u64CurMoves;
+	}
+
+	//撤销最后一次移动（撤销后重新走的棋与直接走的棋生成的数字完全相同，所以回放仍然成立）
+	void PopMove(void)
+	{
+		if (!bActive || u64CurMoves == 0)
+		{
+			return;
+		}
+
+		--u64CurMoves;
+		uint64_t u64Shift = u64CurMoves % 4 * 2;
+		if (u64Shift == 0)
+		{
+			vecBytes.pop_back();
+		}
+		else
+		{
+			vecBytes.back() &= (uint8_t)((1u << u64Shift) - 1);
+		}
+	}
+
+	//结束当前记录，回填移动次数与最终得分
+	void End(uint64_t u64Score)
+	{
+		if (!bActive)
+		{
+			return;
+		}
+
+		uint8_t *pHeader = vecBytes.data() + szCurHeader;
+		Replay_Format::Store<uint64_t>(pHeader + 48, u64CurMoves);
+		Replay_Format::Store<uint64_t>(pHeader + 56, u64Score);
+		bActive = false;
+	}
+
+	bool IsActive(void) const noexcept
+	{
+		return bActive;
+	}
+
+	//已结束的记录占用的字节数（不含正在记录的那条）
+	size_t PendingBytes(void) const noexcept
+	{
+		return bActive ? szCurHeader : vecBytes.size();
+	}
+
+	//把已结束的记录写入文件并从缓冲区移除，正在记录的那条保留
+	bool WriteTo(FILE *fp)
+	{
+		size_t szDone = PendingBytes();
+		if (szDone == 0)
+		{
+			return true;
+		}
+
+		bool bRet = fwrite(vecBytes.data(), 1, szDone, fp) == szDone;
+		vecBytes.erase(vecBytes.begin(), vecBytes.begin() + szDone);
+		szCurHeader = 0;//正在记录的那条（如果有）现在位于缓冲区开头
+		return bRet;
+	}
+};
+
+/*
+回放文件:
+
+POSIX下整个文件只读映射，顺序访问提示内核预读；其它平台一次性读入内存
+*/
+class Replay_File
+{
+private:
+	const uint8_t *pData;
+	size_t szSize;
+#ifdef _WIN32
+	std::vector<uint8_t> vecData;
+#endif
+
+public:
+	Replay_File(void) :
+		pData(NULL),
+		szSize(0)
+	{}
+	~Replay_File(void)
+	{
+		Close();
+	}
+
+	Replay_File(const Replay_File &) = delete;
+	Replay_File &operator=(const Replay_File &) = delete;
+
+	//bSequential为false时提示内核整个文件都会被随机访问（例如估值网络的权重），一次性预读
+	bool Open(const char *pPath, bool bSequential = true)
+	{
+		Close();
+
+#ifdef _WIN32
+		(void)bSequential;
+		FILE *fp = fopen(pPath, "rb");
+		if (fp == NULL)
+		{
+			return false;
+		}
+
+		uint8_t u8Buf[65536];
+		size_t szRead = 0;
+		while ((szRead = fread(u8Buf, 1, sizeof(u8Buf), fp)) != 0)
+		{
+			vecData.insert(vecData.end(), u8Buf, u8Buf + szRead);
+		}
+		fclose(fp);
+
+		pData = vecData.data();
+		szSize = vecData.size();
+		return true;
+#else
+		int fd = open(pPath, O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat st{};
+		if (fstat(fd, &st) != 0)
+		{
+			close(fd);
+			return false;
+		}
+
+		szSize = (size_t)st.st_size;
+		if (szSize == 0)//空文件不能映射，当作没有记录
+		{
+			close(fd);
+			return true;
+		}
+
+		void *pMap = mmap(NULL, szSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);//映射建立后文件描述符可以关闭
+		if (pMap == MAP_FAILED)
+		{
+			szSize = 0;
+			return false;
+		}
+
+		madvise(pMap, szSize, bSequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+		pData = (const uint8_t *)pMap;
+		return true;
+#endif
+	}
+
+	void Close(void)
+	{
+#ifdef _WIN32
+		vecData.clear();
+		vecData.shrink_to_fit();
+#else
+		if (pData != NULL)
+		{
+			munmap((void *)pData, szSize);
+		}
+#endif
+		pData = NULL;
+		szSize = 0;
+	}
+
+	const uint8_t *Data(void) const noexcept
+	{
+		return pData;
+	}
+
+	size_t Size(void) const noexcept
+	{
+		return szSize;
+	}
+};
+
+//顺序解析一块内存中的记录
+class Replay_Reader
+{
+private:
+	const uint8_t *pData;
+	size_t szSize;
+	size_t szPos;
+	bool bError;//遇到魔数、版本不符或记录被截断
+
+public:
+	Replay_Reader(const uint8_t *_pData, size_t _szSize) :
+		pData(_pData),
+		szSize(_szSize),
+		szPos(0),
+		bError(false)
+	{}
+	~Replay_Reader(void) = default;
+
+	//读取下一条记录，没有更多记录或格式错误时返回false
+	bool Next(Replay_Record &rrOut)
+	{
+		if (bError || szPos >= szSize)
+		{
+			return false;
+		}
+
+		if (szSize - szPos < Replay_Format::szHeaderSize)
+		{
+			bError = true;
+			return false;
+		}
+
+		const uint8_t *pHeader = pData + szPos;
+		if (memcmp(pHeader, Replay_Format::cMagic, sizeof(Replay_Format::cMagic)) != 0 || pHeader[4] != Replay_Format::u8Version)
+		{
+			bError = true;
+			return false;
+		}
+
+		rrOut.u64Offset = szPos;
+		rrOut.u8Width = pHeader[5];
+		rrOut.u8Height = pHeader[6];
+		rrOut.u64Seed = Replay_Format::Load<uint64_t>(pHeader + 8);
+		rrOut.u64Stream = Replay_Format::Load<uint64_t>(pHeader + 16);
+		rrOut.u64Position = Replay_Format::Load<uint64_t>(pHeader + 24);
+		rrOut.dSpawnWeights_2 = Replay_Format::Load<double>(pHeader + 32);
+		rrOut.dSpawnWeights_4 = Replay_Format::Load<double>(pHeader + 40);
+		rrOut.u64MoveCount = Replay_Format::Load<uint64_t>(pHeader + 48);
+		rrOut.u64ClaimedScore = Replay_Format::Load<uint64_t>(pHeader + 56);
+		rrOut.pMoves = pHeader + Replay_Format::szHeaderSize;
+
+		//先比较移动次数，避免计算字节数时溢出
+		size_t szRemain = szSize - szPos - Replay_Format::szHeaderSize;
+		if (rrOut.u64MoveCount / 4 > szRemain || Replay_Format::MoveBytes(rrOut.u64MoveCount) > szRemain)
+		{
+			bError = true;
+			return false;
+		}
+
+		szPos += Replay_Format::szHeaderSize + Replay_Format::MoveBytes(rrOut.u64MoveCount);
+		return true;
+	}
+
+	bool HasError(void) const noexcept
+	{
+		return bError;
+	}
+
+	size_t GetPosition(void) const noexcept
+	{
+		return szPos;
+	}
+};
+
+/*
+重放:
+
+按记录头重建引擎，不经过终端，逐步调用ProcessMove重放移动流
+没有改变棋盘的移动、游戏结束后的移动、不支持的尺寸、不合法的生成权重都视为不合法
+*/
+class Replay_Player
+{
+public:
+	constexpr const static inline uint64_t u64MaxCells = 256;//结果中棋盘的最大格子数（16*16）
+
+	struct Outcome
+	{
+		bool bLegal = false;//所有移动都合法
+		bool bScoreMatch = false;//重放得分与声明得分一致
+		uint64_t u64FirstIllegal = 0;//第一个不合法移动的序号，合法时等于移动次数
+		uint64_t u64Score = 0;//重放得到的得分
+		GameStatus enStatus = InGame;//最终状态
+		uint8_t u8Width = 0;
+		uint8_t u8Height = 0;
+		uint8_t u8Exp[u64MaxCells] = {};//最终棋盘，按行存指数
+	};
+
+	template<uint64_t W, uint64_t H>
+	static Outcome SimulateAs(const Replay_Record &rrGame)
+	{
+		static_assert(W * H <= u64MaxCells, "Board too large for Replay_Player::Outcome");
+
+		Rand_Counter randGen = Rand_Counter::Stream(rrGame.u64Seed, rrGame.u64Stream);
+		randGen.SetPosition(rrGame.u64Position);
+
+		Game2048_Engine<W, H> engGame{ randGen, rrGame.dSpawnWeights_2, rrGame.dSpawnWeights_4 };
+		engGame.Reset();
+
+		Outcome ocRet{};
+		ocRet.u8Width = (uint8_t)W;
+		ocRet.u8Height = (uint8_t)H;
+		ocRet.bLegal = true;
+
+		//一次取一个字节解出4步
+		uint64_t u64Index = 0;
+		for (size_t i = 0; i < Replay_Format::MoveBytes(rrGame.u64MoveCount) && ocRet.bLegal; ++i)
+		{
+			uint8_t u8Byte = rrGame.pMoves[i];
+			for (uint64_t j = 0; j < 4 && u64Index < rrGame.u64MoveCount; ++j, ++u64Index, u8Byte >>= 2)
+			{
+				if (engGame.GetStatus() == WinGame)
+				{
+					engGame.ContinueAfterWin();
+				}
+
+				if (!engGame.ProcessMove((Direction)(u8Byte & 0x3)))
+				{
+					ocRet.bLegal = false;
+					break;
+				}
+			}
+		}
+
+		ocRet.u64FirstIllegal = u64Index;
+		ocRet.u64Score = engGame.GetScore();
+		ocRet.bScoreMatch = ocRet.u64Score == rrGame.u64ClaimedScore;
+		ocRet.enStatus = engGame.GetStatus();
+		for (uint64_t i = 0; i < W * H; ++i)
+		{
+			ocRet.u8Exp[i] = engGame.GetBoard().GetExp(i);
+		}
+
+		return ocRet;
+	}
+
+	//按记录中的尺寸分派到对应的模板实例，与交互模式支持的尺寸相同
+	static Outcome Simulate(const Replay_Record &rrGame)
+	{
+		if (rrGame.u8Width == rrGame.u8Height && Replay_Format::ValidWeights(rrGame.dSpawnWeights_2, rrGame.dSpawnWeights_4))
+		{
+			switch (rrGame.u8Width)
+			{
+			case 3:
+				return SimulateAs<3, 3>(rrGame);
+			case 4:
+				return SimulateAs<4, 4>(rrGame);
+			case 5:
+				return SimulateAs<5, 5>(rrGame);
+			case 6:
+				return SimulateAs<6, 6>(rrGame);
+			case 8:
+				return SimulateAs<8, 8>(rrGame);
+			case 16:
+				return SimulateAs<16, 16>(rrGame);
+			default:
+				break;
+			}
+		}
+
+		Outcome ocRet{};
+		ocRet.u8Width = rrGame.u8Width;
+		ocRet.u8Height = rrGame.u8Height;
+		return ocRet;
+	}
+
+	//命令行入口：game2048 --replay <file>，顺序重放文件中的所有记录并输出统计
+	static int Main(int argc, char *argv[])
+	{
+		if (argc < 3)
+		{
+			fprintf(stderr, "Usage: %s --replay <file>\n", argv[0]);
+			return 1;
+		}
+
+		Replay_File rfInput{};
+		if (!rfInput.Open(argv[2]))
+		{
+			fprintf(stderr, "Error: cannot open replay file %s\n", argv[2]);
+			return 1;
+		}
+
+		uint64_t u64Records = 0;
+		uint64_t u64Legal = 0;
+		uint64_t u64ScoreMatch = 0;
+		uint64_t u64Moves = 0;
+		uint64_t u64TotalScore = 0;
+
+		auto tpBeg = std::chrono::steady_clock::now();
+
+		Replay_Reader rdInput{ rfInput.Data(), rfInput.Size() };
+		Replay_Record rrGame{};
+		while (rdInput.Next(rrGame))
+		{
+			Outcome ocGame = Simulate(rrGame);
+
+			++u64Records;
+			u64Legal += ocGame.bLegal;
+			u64ScoreMatch += ocGame.bScoreMatch;
+			u64Moves += ocGame.u64FirstIllegal;
+			u64TotalScore += ocGame.u64Score;
+		}
+
+		auto tpEnd = std::chrono::steady_clock::now();
+		double dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+
+		printf("bytes=%llu\n", (unsigned long long)rfInput.Size());
+		printf("records=%llu\n", (unsigned long long)u64Records);
+		printf("legal=%llu\n", (unsigned long long)u64Legal);
+		printf("score_match=%llu\n", (unsigned long long)u64ScoreMatch);
+		printf("moves=%llu\n", (unsigned long long)u64Moves);
+		printf("score_total=%llu\n", (unsigned long long)u64TotalScore);
+		printf("format_error=%d\n", rdInput.HasError() ? 1 : 0);
+		printf("seconds=%.3f\n", dSeconds);
+		printf("moves_per_second=%.1f\n", dSeconds > 0.0 ? (double)u64Moves / dSeconds : 0.0);
+
+		return rdInput.HasError() ? 1 : 0;
+	}
+};
@@ -0,0 +1,719 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <vector>
+#include <string>
+#include <random>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "Game_Engine.hpp"
+
+/*
+多会话服务器（仅Linux，epoll）:
+
+一个进程在本地Unix套接字上接受任意多个客户端，单线程事件循环服务所有连接，
+所有局面都放在一张预先分配的连续会话表里，空位用空闲栈回收，处理命令时不为局面分配内存
+每个连接自己的输入输出缓冲和会话列表随连接按需增长，但都有上限：
+输入最多一行加一次读取的长度，积压的回复超过szMaxPendingOut断开，会话数不超过u64MaxSessionsPerConnection
+会话号为(代数 << 32) | 槽位，槽位回收后代数加一，旧的会话号不会误用到新的一局
+
+行协议，每行一条命令，参数用空格分隔，每条命令回复一行，成功以OK开头，失败以ERR开头：
+	NEW [seed]            -> OK <会话号>
+	MOVE <会话号> <U|D|L|R> -> OK <是否移动0/1> <得分> <状态>
+	BOARD <会话号>         -> OK <得分> <状态> <棋盘>
+	END <会话号>           -> OK
+	QUIT                  -> OK，之后关闭连接
+状态为ingame/win/lost，赢了之后再MOVE会继续玩；棋盘格式与--verify相同（按行的指数，'/'分隔）
+会话属于创建它的连接，连接断开时它的所有会话一起回收；一个连接开满上限后NEW回复ERR too many sessions
+*/
+class Session_Server
+{
+public:
+	struct Config
+	{
+		const char *pPath = NULL;//套接字路径
+		uint64_t u64MaxSessions = 65536;//会话表大小
+		uint64_t u64MaxConnections = 4096;//最多同时连接数
+		uint64_t u64MaxSessionsPerConnection = 1024;//单个连接最多同时持有的会话数，防止一个客户端占满会话表
+		uint64_t u64Seed = 0;//主种子，NEW不带种子时由它派生每局的种子
+	};
+
+	struct Summary
+	{
+		uint64_t u64Connections = 0;//累计接受的连接
+		uint64_t u64Sessions = 0;//累计创建的会话
+		uint64_t u64Commands = 0;//累计处理的命令
+		uint64_t u64PeakSessions = 0;//同时存在的会话数峰值
+	};
+
+private:
+	using Engine = Game2048_Engine<>;
+
+	constexpr const static inline size_t szMaxLine = 256;//超过这个长度还没有换行则断开连接
+	constexpr const static inline size_t szMaxPendingOut = (size_t)1 << 20;//客户端不读回复，积压超过此数则断开
+	constexpr const static inline size_t szMaxReadPerEvent = (size_t)64 << 10;//一次可读事件最多读取的字节数，剩下的等下一轮，避免一个连接饿死其它连接
+	constexpr const static inline int iMaxEvents = 64;
+
+	struct Session
+	{
+		Engine engGame;
+		uint32_t u32Gen;//代数，槽位每次分配加一
+		int32_t iOwner;//所属连接的fd，-1为空闲
+	};
+
+	struct Connection
+	{
+		bool bOpen = false;
+		bool bClosing = false;//不再读取，回复发完后关闭
+		uint32_t u32Events = 0;//当前在epoll中注册的事件
+		std::string strIn;//未处理完的输入
+		std::string strOut;//未发完的回复
+		std::vector<uint32_t> vecOwned;//本连接的会话槽位
+	};
+
+	const Config &cfgServer;
+	Summary smTotal;
+
+	std::vector<Session> vecSession;//会话表，大小固定
+	std::vector<uint32_t> vecFree;//空闲槽位栈
+	std::vector<Connection> vecConn;//按fd索引的连接表
+
+	int iListenFd;
+	int iEpollFd;
+
+	static inline volatile sig_atomic_t bStop = 0;
+
+private:
+	static void OnStopSignal(int iSignal)
+	{
+		(void)iSignal;
+		bStop = 1;
+	}
+
+	static const char *StatusName(GameStatus enStatus) noexcept
+	{
+		switch (enStatus)
+		{
+		case InGame:
+			return "ingame";
+		case WinGame:
+			return "win";
+		case LostGame:
+			return "lost";
+		default:
+			return "unknown";
+		}
+	}
+
+	static bool ParseNumber(const char *pText, uint64_t &u64Value) noexcept
+	{
+		if (pText == NULL || *pText == '\0')
+		{
+			return false;
+		}
+		char *pEnd = NULL;
+		errno = 0;
+		u64Value = strtoull(pText, &pEnd, 10);
+		return errno == 0 && *pEnd == '\0';
+	}
+
+	static bool ParseDirection(const char *pText, Direction &dMove) noexcept
+	{
+		if (pText == NULL || pText[0] == '\0' || pText[1] != '\0')
+		{
+			return false;
+		}
+		switch (pText[0])
+		{
+		case 'U': case 'u': case 'W': case 'w':
+			dMove = Up;
+			return true;
+		case 'D': case 'd': case 'S': case 's':
+			dMove = Dn;
+			return true;
+		case 'L': case 'l': case 'A': case 'a':
+			dMove = Lt;
+			return true;
+		case 'R': case 'r':
+			dMove = Rt;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	//按会话号找到本连接的会话，会话号无效、已经结束或者属于别的连接都返回NULL
+	Session *FindSession(int iFd, const char *pId) noexcept
+	{
+		uint64_t u64Id = 0;
+		if (!ParseNumber(pId, u64Id))
+		{
+			return NULL;
+		}
+
+		uint64_t u64Slot = u64Id & 0xFFFF'FFFF;
+		if (u64Slot >= vecSession.size())
+		{
+			return NULL;
+		}
+
+		Session &ssCur = vecSession[u64Slot];
+		if (ssCur.iOwner != iFd || ssCur.u32Gen != (uint32_t)(u64Id >> 32))
+		{
+			return NULL;
+		}
+		return &ssCur;
+	}
+
+	void FreeSession(Connection &cnCur, uint32_t u32Slot) noexcept
+	{
+		vecSession[u32Slot].iOwner = -1;
+		vecFree.push_back(u32Slot);
+
+		for (size_t i = 0; i < cnCur.vecOwned.size(); ++i)
+		{
+			if (cnCur.vecOwned[i] == u32Slot)
+			{
+				cnCur.vecOwned[i] = cnCur.vecOwned.back();
+				cnCur.vecOwned.pop_back();
+				break;
+			}
+		}
+	}
+
+	void Reply(Connection &cnCur, const char *pFormat, ...) __attribute__((format(printf, 3, 4)))
+	{
+		char cBuf[512];
+		va_list vaArgs;
+		va_start(vaArgs, pFormat);
+		int iLen = vsnprintf(cBuf, sizeof(cBuf), pFormat, vaArgs);
+		va_end(vaArgs);
+		if (iLen > 0)
+		{
+			cnCur.strOut.append(cBuf, (size_t)iLen < sizeof(cBuf) ? (size_t)iLen : sizeof(cBuf) - 1);
+		}
+		cnCur.strOut.push_back('\n');
+	}
+
+	//====================命令====================
+	void HandleLine(int iFd, char *pLine)
+	{
+		Connection &cnCur = vecConn[iFd];
+
+		char *pSave = NULL;
+		const char *pCmd = strtok_r(pLine, " \t", &pSave);
+		const char *pArg1 = strtok_r(NULL, " \t", &pSave);
+		const char *pArg2 = strtok_r(NULL, " \t", &pSave);
+
+		if (pCmd == NULL)//空行不回复
+		{
+			return;
+		}
+		++smTotal.u64Commands;
+
+		if (strcmp(pCmd, "NEW") == 0)
+		{
+			uint64_t u64Seed = 0;
+			if (pArg1 != NULL && !ParseNumber(pArg1, u64Seed))
+			{
+				Reply(cnCur, "ERR bad seed");
+				return;
+			}
+			if (cnCur.vecOwned.size() >= cfgServer.u64MaxSessionsPerConnection)
+			{
+				Reply(cnCur, "ERR too many sessions");
+				return;
+			}
+			if (vecFree.empty())
+			{
+				Reply(cnCur, "ERR server full");
+				return;
+			}
+			if (pArg1 == NULL)
+			{
+				u64Seed = Game2048_Random::StreamKey(cfgServer.u64Seed, smTotal.u64Sessions);
+			}
+
+			uint32_t u32Slot = vecFree.back();
+			vecFree.pop_back();
+			cnCur.vecOwned.push_back(u32Slot);
+
+			Session &ssNew = vecSession[u32Slot];
+			++ssNew.u32Gen;
+			ssNew.iOwner = iFd;
+			ssNew.engGame = Engine{ u64Seed };
+			ssNew.engGame.Reset();
+
+			++smTotal.u64Sessions;
+			uint64_t u64Live = vecSession.size() - vecFree.size();
+			smTotal.u64PeakSessions = u64Live > smTotal.u64PeakSessions ? u64Live : smTotal.u64PeakSessions;
+
+			Reply(cnCur, "OK %llu", (unsigned long long)(((uint64_t)ssNew.u32Gen << 32) | u32Slot));
+		}
+		else if (strcmp(pCmd, "MOVE") == 0)
+		{
+			Session *pSession = FindSession(iFd, pArg1);
+			Direction dMove = Up;
+			if (pSession == NULL)
+			{
+				Reply(cnCur, "ERR unknown session");
+				return;
+			}
+			if (!ParseDirection(pArg2, dMove))
+			{
+				Reply(cnCur, "ERR bad direction");
+				return;
+			}
+
+			Engine &engGame = pSession->engGame;
+			if (engGame.GetStatus() == WinGame)//赢了之后继续玩
+			{
+				engGame.ContinueAfterWin();
+			}
+			bool bMoved = engGame.ProcessMove(dMove);
+			Reply(cnCur, "OK %d %llu %s", bMoved ? 1 : 0, (unsigned long long)engGame.GetScore(), StatusName(engGame.GetStatus()));
+		}
+		else if (strcmp(pCmd, "BOARD") == 0)
+		{
+			Session *pSession = FindSession(iFd, pArg1);
+			if (pSession == NULL)
+			{
+				Reply(cnCur, "ERR unknown session");
+				return;
+			}
+
+			const Engine &engGame = pSession->engGame;
+			char cBoard[Engine::u64TotalSize * 2 + 1];
+			size_t szLen = 0;
+			for (uint64_t i = 0; i < Engine::u64TotalSize; ++i)
+			{
+				if (i != 0 && i % Engine::u64Width == 0)
+				{
+					cBoard[szLen++] = '/';
+				}
+				cBoard[szLen++] = "0123456789abcdef"[engGame.GetBoard().GetExp(i) & 0xF];
+			}
+			cBoard[szLen] = '\0';
+			Reply(cnCur, "OK %llu %s %s", (unsigned long long)engGame.GetScore(), StatusName(engGame.GetStatus()), cBoard);
+		}
+		else if (strcmp(pCmd, "END") == 0)
+		{
+			Session *pSession = FindSession(iFd, pArg1);
+			if (pSession == NULL)
+			{
+				Reply(cnCur, "ERR unknown session");
+				return;
+			}
+			FreeSession(cnCur, (uint32_t)(pSession - vecSession.data()));
+			Reply(cnCur, "OK");
+		}
+		else if (strcmp(pCmd, "QUIT") == 0)
+		{
+			Reply(cnCur, "OK");
+			cnCur.bClosing = true;
+		}
+		else
+		{
+			Reply(cnCur, "ERR unknown command");
+		}
+	}
+
+	//====================连接====================
+	void CloseConnection(int iFd)
+	{
+		Connection &cnCur = vecConn[iFd];
+		for (uint32_t u32Slot : cnCur.vecOwned)
+		{
+			vecSession[u32Slot].iOwner = -1;
+			vecFree.push_back(u32Slot);
+		}
+		cnCur.vecOwned.clear();
+		cnCur.strIn.clear();
+		cnCur.strOut.clear();
+		cnCur.bOpen = false;
+		cnCur.bClosing = false;
+		cnCur.u32Events = 0;
+
+		epoll_ctl(iEpollFd, EPOLL_CTL_DEL, iFd, NULL);
+		close(iFd);
+	}
+
+	//尽量发送积压的回复，发不完就等EPOLLOUT；返回false代表连接已关闭
+	bool FlushConnection(int iFd)
+	{
+		Connection &cnCur = vecConn[iFd];
+		size_t szSent = 0;
+		while (szSent < cnCur.strOut.size())
+		{
+			ssize_t iRet = send(iFd, cnCur.strOut.data() + szSent, cnCur.strOut.size() - szSent, MSG_NOSIGNAL);
+			if (iRet > 0)
+			{
+				szSent += (size_t)iRet;
+				continue;
+			}
+			if (iRet < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (iRet < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				break;
+			}
+			CloseConnection(iFd);
+			return false;
+		}
+		cnCur.strOut.erase(0, szSent);
+
+		if (cnCur.strOut.empty() && cnCur.bClosing)
+		{
+			CloseConnection(iFd);
+			return false;
+		}
+		if (cnCur.strOut.size() > szMaxPendingOut)
+		{
+			CloseConnection(iFd);
+			return false;
+		}
+
+		//还有回复没发完就等可写；准备关闭的连接不再关心可读，避免对端半关闭后一直被唤醒
+		uint32_t u32Events = (cnCur.bClosing ? 0u : (uint32_t)(EPOLLIN | EPOLLRDHUP)) | (cnCur.strOut.empty() ? 0u : (uint32_t)EPOLLOUT);
+		if (u32Events != cnCur.u32Events)
+		{
+			epoll_event evCur{};
+			evCur.events = u32Events;
+			evCur.data.fd = iFd;
+			epoll_ctl(iEpollFd, EPOLL_CTL_MOD, iFd, &evCur);
+			cnCur.u32Events = u32Events;
+		}
+		return true;
+	}
+
+	//处理输入缓冲中所有完整的行，剩下不完整的一行留到下次
+	void HandleLines(int iFd)
+	{
+		Connection &cnCur = vecConn[iFd];
+		size_t szBeg = 0;
+		while (!cnCur.bClosing)
+		{
+			size_t szEnd = cnCur.strIn.find('\n', szBeg);
+			if (szEnd == std::string::npos)
+			{
+				break;
+			}
+
+			char cLine[szMaxLine + 1];
+			size_t szLen = szEnd - szBeg;
+			if (szLen > 0 && cnCur.strIn[szEnd - 1] == '\r')
+			{
+				--szLen;
+			}
+			if (szLen > szMaxLine)
+			{
+				Reply(cnCur, "ERR line too long");
+				cnCur.bClosing = true;
+				break;
+			}
+			memcpy(cLine, cnCur.strIn.data() + szBeg, szLen);
+			cLine[szLen] = '\0';
+			szBeg = szEnd + 1;
+
+			HandleLine(iFd, cLine);
+		}
+		cnCur.strIn.erase(0, szBeg);
+
+		if (cnCur.strIn.size() > szMaxLine && !cnCur.bClosing)
+		{
+			Reply(cnCur, "ERR line too long");
+			cnCur.bClosing = true;
+		}
+	}
+
+	//每读一块就处理其中完整的行，输入缓冲始终不超过一行加一块；
+	//一次最多读szMaxReadPerEvent，epoll是水平触发，没读完的数据下一轮还会通知
+	void ReadConnection(int iFd)
+	{
+		Connection &cnCur = vecConn[iFd];
+		char cBuf[4096];
+		size_t szRead = 0;
+		bool bEof = false;
+		while (!cnCur.bClosing && szRead < szMaxReadPerEvent && cnCur.strOut.size() <= szMaxPendingOut)
+		{
+			ssize_t iRet = read(iFd, cBuf, sizeof(cBuf));
+			if (iRet > 0)
+			{
+				szRead += (size_t)iRet;
+				cnCur.strIn.append(cBuf, (size_t)iRet);
+				HandleLines(iFd);
+				continue;
+			}
+			if (iRet < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (iRet < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			{
+				break;
+			}
+			bEof = true;//对端关闭（可能只是半关闭）或出错，已经收到的命令都处理过了，发完回复再关
+			break;
+		}
+
+		if (bEof)
+		{
+			cnCur.bClosing = true;
+		}
+		FlushConnection(iFd);
+	}
+
+	void AcceptConnections(void)
+	{
+		while (true)
+		{
+			int iFd = accept4(iListenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (iFd < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				return;//EAGAIN或者暂时无法接受（例如fd耗尽），下次再试
+			}
+
+			if ((size_t)iFd >= vecConn.size())
+			{
+				if ((uint64_t)iFd >= cfgServer.u64MaxConnections + 64)//fd与连接数大致相当，留一点给其它描述符
+				{
+					close(iFd);
+					continue;
+				}
+				vecConn.resize((size_t)iFd + 1);
+			}
+
+			epoll_event evCur{};
+			evCur.events = EPOLLIN | EPOLLRDHUP;
+			evCur.data.fd = iFd;
+			if (epoll_ctl(iEpollFd, EPOLL_CTL_ADD, iFd, &evCur) != 0)
+			{
+				close(iFd);
+				continue;
+			}
+
+			vecConn[iFd].bOpen = true;
+			vecConn[iFd].u32Events = evCur.events;
+			++smTotal.u64Connections;
+		}
+	}
+
+	bool Listen(void)
+	{
+		sockaddr_un saAddr{};
+		saAddr.sun_family = AF_UNIX;
+		if (strlen(cfgServer.pPath) >= sizeof(saAddr.sun_path))
+		{
+			fprintf(stderr, "Error: socket path too long: %s\n", cfgServer.pPath);
+			return false;
+		}
+		strcpy(saAddr.sun_path, cfgServer.pPath);
+
+		iListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (iListenFd < 0)
+		{
+			perror("socket");
+			return false;
+		}
+
+		unlink(cfgServer.pPath);//上次没有正常退出留下的套接字文件
+		if (bind(iListenFd, (const sockaddr *)&saAddr, sizeof(saAddr)) != 0 || listen(iListenFd, 1024) != 0)
+		{
+			perror("bind/listen");
+			return false;
+		}
+
+		iEpollFd = epoll_create1(EPOLL_CLOEXEC);
+		if (iEpollFd < 0)
+		{
+			perror("epoll_create1");
+			return false;
+		}
+
+		epoll_event evListen{};
+		evListen.events = EPOLLIN;
+		evListen.data.fd = iListenFd;
+		return epoll_ctl(iEpollFd, EPOLL_CTL_ADD, iListenFd, &evListen) == 0;
+	}
+
+public:
+	explicit Session_Server(const Config &_cfgServer) :
+		cfgServer(_cfgServer),
+		smTotal(),
+		vecSession(),
+		vecFree(),
+		vecConn(),
+		iListenFd(-1),
+		iEpollFd(-1)
+	{
+		//整张会话表一次分配好，空闲栈倒序放入使先分配低槽位
+		vecSession.assign(cfgServer.u64MaxSessions, Session{ Engine{ (uint64_t)0 }, 0, -1 });
+		vecFree.reserve(cfgServer.u64MaxSessions);
+		for (uint64_t i = cfgServer.u64MaxSessions; i != 0; --i)
+		{
+			vecFree.push_back((uint32_t)(i - 1));
+		}
+		vecConn.reserve(cfgServer.u64MaxConnections + 64);
+
+		MoveTable::Get();
+	}
+	~Session_Server(void)
+	{
+		for (size_t i = 0; i < vecConn.size(); ++i)
+		{
+			if (vecConn[i].bOpen)
+			{
+				CloseConnection((int)i);
+			}
+		}
+		if (iEpollFd >= 0)
+		{
+			close(iEpollFd);
+		}
+		if (iListenFd >= 0)
+		{
+			close(iListenFd);
+			unlink(cfgServer.pPath);
+		}
+	}
+
+	Session_Server(const Session_Server &) = delete;
+	Session_Server &operator=(const Session_Server &) = delete;
+
+	//监听并运行事件循环，直到收到SIGINT或SIGTERM
+	bool Run(void)
+	{
+		if (!Listen())
+		{
+			return false;
+		}
+
+		struct sigaction saStop{};
+		saStop.sa_handler = &OnStopSignal;
+		sigemptyset(&saStop.sa_mask);
+		sigaction(SIGINT, &saStop, NULL);
+		sigaction(SIGTERM, &saStop, NULL);
+
+		epoll_event evArr[iMaxEvents];
+		while (!bStop)
+		{
+			int iCount = epoll_wait(iEpollFd, evArr, iMaxEvents, -1);
+			if (iCount < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				perror("epoll_wait");
+				return false;
+			}
+
+			for (int i = 0; i < iCount; ++i)
+			{
+				int iFd = evArr[i].data.fd;
+				if (iFd == iListenFd)
+				{
+					AcceptConnections();
+					continue;
+				}
+				if ((size_t)iFd >= vecConn.size() || !vecConn[iFd].bOpen)//同一批事件中已经被关闭
+				{
+					continue;
+				}
+
+				uint32_t u32Events = evArr[i].events;
+				if (u32Events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+				{
+					ReadConnection(iFd);
+				}
+				else if (u32Events & EPOLLOUT)
+				{
+					FlushConnection(iFd);
+				}
+			}
+		}
+		return true;
+	}
+
+	const Summary &GetSummary(void) const noexcept
+	{
+		return smTotal;
+	}
+
+	//命令行入口：game2048 --serve <path> [--max-sessions N] [--max-connections N] [--max-sessions-per-connection N] [--seed S]
+	static int Main(int argc, char *argv[])
+	{
+		auto Usage = [&](void) -> int
+		{
+			fprintf(stderr, "Usage: %s --serve <socket path> [--max-sessions N] [--max-connections N] [--max-sessions-per-connection N] [--seed S]\n", argv[0]);
+			return 1;
+		};
+
+		if (argc < 3)
+		{
+			return Usage();
+		}
+
+		Config cfgServer{};
+		cfgServer.pPath = argv[2];
+		cfgServer.u64Seed = ((uint64_t)std::random_device{}() << 32) | std::random_device{}();
+		for (int i = 3; i + 1 < argc; i += 2)
+		{
+			if (strcmp(argv[i], "--max-sessions") == 0)
+			{
+				cfgServer.u64MaxSessions = strtoull(argv[i + 1], NULL, 10);
+			}
+			else if (strcmp(argv[i], "--max-connections") == 0)
+			{
+				cfgServer.u64MaxConnections = strtoull(argv[i + 1], NULL, 10);
+			}
+			else if (strcmp(argv[i], "--max-sessions-per-connection") == 0)
+			{
+				cfgServer.u64MaxSessionsPerConnection = strtoull(argv[i + 1], NULL, 10);
+			}
+			else if (strcmp(argv[i], "--seed") == 0)
+			{
+				cfgServer.u64Seed = strtoull(argv[i + 1], NULL, 10);
+			}
+			else
+			{
+				return Usage();
+			}
+		}
+		if ((argc - 3) % 2 != 0 || cfgServer.u64MaxSessions == 0 || cfgServer.u64MaxSessions > 0xFFFF'FFFF || cfgServer.u64MaxConnections == 0 || cfgServer.u64MaxSessionsPerConnection == 0)
+		{
+			return Usage();
+		}
+
+		Session_Server ssMain{ cfgServer };
+		printf("listening=%s\n", cfgServer.pPath);
+		fflush(stdout);
+
+		bool bRet = ssMain.Run();
+
+		const Summary &smTotal = ssMain.GetSummary();
+		printf("connections=%llu\n", (unsigned long long)smTotal.u64Connections);
+		printf("sessions=%llu\n", (unsigned long long)smTotal.u64Sessions);
+		printf("peak_sessions=%llu\n", (unsigned long long)smTotal.u64PeakSessions);
+		printf("commands=%llu\n", (unsigned long long)smTotal.u64Commands);
+		return bRet ? 0 : 1;
+	}
+};
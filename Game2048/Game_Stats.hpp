@@ -0,0 +1,345 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <atomic>
+
+#ifdef GAME2048_STATS
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#endif
+#endif
+
+/*
+运行统计:
+
+只有编译时定义了GAME2048_STATS才生效，否则所有接口都是空函数，热路径上没有任何代码
+每个线程第一次计数时领取一个独占缓存行的槽位，计数只读写自己的槽位（不需要原子加），
+线程数超过槽位数时多出来的线程共用最后一个槽位并改用原子加
+汇总时把所有槽位相加，得到的是某一时刻附近的近似值，不会阻塞计数的线程
+
+导出格式与批量模拟相同（每行一个key=value），可以在退出时自动输出，
+非Windows下还可以随时发送SIGUSR1输出一次当前值：
+	GAME2048_STATS_OUT=<文件> 输出追加到文件，不设置则输出到标准错误
+*/
+class Game2048_Stats
+{
+public:
+	enum Counter : size_t
+	{
+		MoveAttempt = 0,//ProcessMove调用次数
+		MoveApply,//实际改变了棋盘的移动
+		Merge,//合并总次数
+		Spawn,//生成的数字总数
+		LegalMaskUpdate,//合法方向掩码重新计算的次数（移动后与生成数字后各一次，游戏是否结束由掩码判断）
+		FrameRender,//终端实际输出的帧数
+		BytesWrite,//写入终端的字节数
+		Counter_End,
+	};
+
+	constexpr const static inline size_t szMergeBins = 9;//每步合并次数的分布，最后一格为8次及以上
+	constexpr const static inline size_t szSpawnBins = 16;//生成数字的指数分布
+
+#ifdef GAME2048_STATS
+	constexpr const static inline bool bEnabled = true;
+#else
+	constexpr const static inline bool bEnabled = false;
+#endif
+
+	//所有槽位相加的结果
+	struct Snapshot
+	{
+		uint64_t u64Counter[Counter_End];
+		uint64_t u64MergeHist[szMergeBins];
+		uint64_t u64SpawnHist[szSpawnBins];
+		uint64_t u64Threads;//领取过槽位的线程数
+	};
+
+private:
+	constexpr const static inline size_t szSlotCount = 128;
+
+	struct alignas(64) Slot
+	{
+		std::atomic<uint64_t> atCounter[Counter_End];
+		std::atomic<uint64_t> atMergeHist[szMergeBins];
+		std::atomic<uint64_t> atSpawnHist[szSpawnBins];
+	};
+
+	struct Registry
+	{
+		Slot slArr[szSlotCount];
+		std::atomic<uint64_t> atNextSlot;
+		int iOutFd = 2;//导出目标，默认为标准错误，进程启动时打开，信号处理中直接write
+	};
+
+	struct Local
+	{
+		Slot *pSlot = nullptr;
+		bool bShared = false;
+	};
+
+private:
+	static Registry &GetRegistry(void) noexcept
+	{
+		static Registry rgStats{};
+		return rgStats;
+	}
+
+	static Local &GetLocal(void) noexcept
+	{
+		thread_local Local lcThread{};
+		if (lcThread.pSlot == nullptr)
+		{
+			Registry &rgStats = GetRegistry();
+			uint64_t u64Index = rgStats.atNextSlot.fetch_add(1, std::memory_order_relaxed);
+			lcThread.bShared = u64Index >= szSlotCount - 1;
+			lcThread.pSlot = &rgStats.slArr[lcThread.bShared ? szSlotCount - 1 : u64Index];
+		}
+		return lcThread;
+	}
+
+	//独占槽位只有本线程写，读改写不需要锁总线；共用槽位才用原子加
+	static void Bump(std::atomic<uint64_t> &atValue, uint64_t u64Add, bool bShared) noexcept
+	{
+		if (bShared)
+		{
+			atValue.fetch_add(u64Add, std::memory_order_relaxed);
+		}
+		else
+		{
+			atValue.store(atValue.load(std::memory_order_relaxed) + u64Add, std::memory_order_relaxed);
+		}
+	}
+
+	//以下只使用可重入的操作，信号处理中也可以调用
+	static size_t AppendText(char *pBuf, size_t szLen, const char *pText) noexcept
+	{
+		while (*pText != '\0')
+		{
+			pBuf[szLen++] = *pText++;
+		}
+		return szLen;
+	}
+
+	static size_t AppendNumber(char *pBuf, size_t szLen, uint64_t u64Value) noexcept
+	{
+		char cDigit[20];
+		size_t szDigits = 0;
+		do
+		{
+			cDigit[szDigits++] = (char)('0' + u64Value % 10);
+			u64Value /= 10;
+		} while (u64Value != 0);
+
+		while (szDigits != 0)
+		{
+			pBuf[szLen++] = cDigit[--szDigits];
+		}
+		return szLen;
+	}
+
+	static size_t AppendLine(char *pBuf, size_t szLen, const char *pKey, uint64_t u64Value) noexcept
+	{
+		szLen = AppendText(pBuf, szLen, "stats_");
+		szLen = AppendText(pBuf, szLen, pKey);
+		pBuf[szLen++] = '=';
+		szLen = AppendNumber(pBuf, szLen, u64Value);
+		pBuf[szLen++] = '\n';
+		return szLen;
+	}
+
+	static void WriteOut(const char *pData, size_t szLen) noexcept
+	{
+#ifdef GAME2048_STATS
+		int iFd = GetRegistry().iOutFd;
+		while (szLen != 0)
+		{
+#ifdef _WIN32
+			int iRet = _write(iFd, pData, (unsigned int)szLen);
+#else
+			ssize_t iRet = write(iFd, pData, szLen);
+#endif
+			if (iRet <= 0)
+			{
+				return;
+			}
+			pData += iRet;
+			szLen -= (size_t)iRet;
+		}
+#else
+		(void)pData;
+		(void)szLen;
+#endif
+	}
+
+	static void DumpAtExit(void)
+	{
+		Dump();
+	}
+
+#if defined(GAME2048_STATS) && !defined(_WIN32)
+	static void DumpOnSignal(int iSignal)
+	{
+		(void)iSignal;
+		Dump();
+	}
+#endif
+
+public:
+	//====================计数====================
+	static void Add(Counter enCounter, uint64_t u64Add = 1) noexcept
+	{
+#ifdef GAME2048_STATS
+		Local &lcThread = GetLocal();
+		Bump(lcThread.pSlot->atCounter[enCounter], u64Add, lcThread.bShared);
+#else
+		(void)enCounter;
+		(void)u64Add;
+#endif
+	}
+
+	//一次实际移动，记录其中的合并次数
+	static void AddMerges(uint64_t u64Merges) noexcept
+	{
+#ifdef GAME2048_STATS
+		Local &lcThread = GetLocal();
+		Bump(lcThread.pSlot->atCounter[Merge], u64Merges, lcThread.bShared);
+		Bump(lcThread.pSlot->atMergeHist[u64Merges < szMergeBins ? u64Merges : szMergeBins - 1], 1, lcThread.bShared);
+#else
+		(void)u64Merges;
+#endif
+	}
+
+	static void AddSpawn(uint8_t u8Exp) noexcept
+	{
+#ifdef GAME2048_STATS
+		Local &lcThread = GetLocal();
+		Bump(lcThread.pSlot->atCounter[Spawn], 1, lcThread.bShared);
+		Bump(lcThread.pSlot->atSpawnHist[u8Exp & (szSpawnBins - 1)], 1, lcThread.bShared);
+#else
+		(void)u8Exp;
+#endif
+	}
+
+	//====================汇总与导出====================
+	static Snapshot Collect(void) noexcept
+	{
+		Snapshot snRet{};
+#ifdef GAME2048_STATS
+		Registry &rgStats = GetRegistry();
+		uint64_t u64Used = rgStats.atNextSlot.load(std::memory_order_relaxed);
+		snRet.u64Threads = u64Used;
+		for (size_t i = 0; i < szSlotCount && i < u64Used; ++i)
+		{
+			const Slot &slCur = rgStats.slArr[i];
+			for (size_t c = 0; c < Counter_End; ++c)
+			{
+				snRet.u64Counter[c] += slCur.atCounter[c].load(std::memory_order_relaxed);
+			}
+			for (size_t b = 0; b < szMergeBins; ++b)
+			{
+				snRet.u64MergeHist[b] += slCur.atMergeHist[b].load(std::memory_order_relaxed);
+			}
+			for (size_t b = 0; b < szSpawnBins; ++b)
+			{
+				snRet.u64SpawnHist[b] += slCur.atSpawnHist[b].load(std::memory_order_relaxed);
+			}
+		}
+#endif
+		return snRet;
+	}
+
+	//格式化为key=value行，返回长度；缓冲区至少szFormatSize字节
+	constexpr const static inline size_t szFormatSize = 2048;
+	static size_t Format(const Snapshot &snStats, char *pBuf) noexcept
+	{
+		constexpr const char *pCounterName[Counter_End] =
+		{
+			"moves_attempted",
+			"moves_applied",
+			"merges",
+			"spawns",
+			"legal_mask_updates",
+			"frames_rendered",
+			"bytes_written",
+		};
+
+		size_t szLen = 0;
+		szLen = AppendLine(pBuf, szLen, "threads", snStats.u64Threads);
+		for (size_t c = 0; c < Counter_End; ++c)
+		{
+			szLen = AppendLine(pBuf, szLen, pCounterName[c], snStats.u64Counter[c]);
+		}
+
+		//分布按"前缀_下标"命名，零值省略
+		char cKey[32];
+		for (size_t b = 0; b < szMergeBins; ++b)
+		{
+			if (snStats.u64MergeHist[b] != 0)
+			{
+				size_t szKey = AppendText(cKey, 0, "merges_per_move_");
+				szKey = AppendNumber(cKey, szKey, b);
+				cKey[szKey] = '\0';
+				szLen = AppendLine(pBuf, szLen, cKey, snStats.u64MergeHist[b]);
+			}
+		}
+		for (size_t b = 0; b < szSpawnBins; ++b)
+		{
+			if (snStats.u64SpawnHist[b] != 0)
+			{
+				size_t szKey = AppendText(cKey, 0, "spawn_value_");
+				szKey = AppendNumber(cKey, szKey, (uint64_t)1 << b);
+				cKey[szKey] = '\0';
+				szLen = AppendLine(pBuf, szLen, cKey, snStats.u64SpawnHist[b]);
+			}
+		}
+		return szLen;
+	}
+
+	//汇总并写到导出目标，可以在信号处理中调用
+	static void Dump(void) noexcept
+	{
+		if constexpr (bEnabled)
+		{
+			char cBuf[szFormatSize];
+			size_t szLen = Format(Collect(), cBuf);
+			WriteOut(cBuf, szLen);
+		}
+	}
+
+	//进程启动时调用一次：打开导出目标，注册退出时与SIGUSR1时的输出
+	static void Install(void)
+	{
+#ifdef GAME2048_STATS
+		Registry &rgStats = GetRegistry();
+		const char *pPath = getenv("GAME2048_STATS_OUT");
+		if (pPath != NULL && pPath[0] != '\0')
+		{
+#ifdef _WIN32
+			int iFd = _open(pPath, _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, 0644);
+#else
+			int iFd = open(pPath, O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+			if (iFd >= 0)
+			{
+				rgStats.iOutFd = iFd;
+			}
+		}
+
+		atexit(&DumpAtExit);
+#ifndef _WIN32
+		struct sigaction saDump{};
+		saDump.sa_handler = &DumpOnSignal;
+		sigemptyset(&saDump.sa_mask);
+		saDump.sa_flags = SA_RESTART;
+		sigaction(SIGUSR1, &saDump, NULL);
+#endif
+#endif
+	}
+};
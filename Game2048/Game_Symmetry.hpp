@@ -0,0 +1,182 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+
+#include "Game_Board.hpp"
+
+/*
+4*4棋盘的8种对称变换（旋转与翻转）:
+
+移动规则在旋转与翻转下不变：把棋盘变换后再朝变换后的方向移动，与先移动再变换得到的局面相同
+	Apply(bb.Move(d), s) == Apply(bb, s).Move(MapDirection(d, s))
+变换编号s的3个位依次组合：第2位先转置，然后第0位左右翻转，第1位上下翻转，8个编号正好是全部8种变换
+规范形式取8个变换结果中原始值最小的一个，缓存、开局库与统计按规范形式存储时每个等价类只占一项
+*/
+class Board_Symmetry
+{
+public:
+	constexpr const static inline uint8_t u8SymCount = 8;
+	constexpr const static inline uint8_t u8FlipH = 1 << 0;//左右翻转
+	constexpr const static inline uint8_t u8FlipV = 1 << 1;//上下翻转
+	constexpr const static inline uint8_t u8Transpose = 1 << 2;//转置（先于翻转）
+
+	struct Canonical
+	{
+		BitBoard bbBoard;//规范形式
+		uint8_t u8Sym;//Apply(原棋盘, u8Sym) == bbBoard
+	};
+
+private:
+	//方向在变换后对应的方向，[s][d]
+	constexpr const static inline auto arrMapDir = [](void) -> std::array<std::array<Direction, Direction::Enum_End>, u8SymCount>
+	{
+		std::array<std::array<Direction, Direction::Enum_End>, u8SymCount> arrRet{};
+		for (uint8_t s = 0; s < u8SymCount; ++s)
+		{
+			for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+			{
+				Direction dCur = (Direction)d;
+				if (s & u8Transpose)//上下与左右互换
+				{
+					constexpr Direction dTrans[Direction::Enum_End] = { Lt, Rt, Up, Dn };
+					dCur = dTrans[dCur];
+				}
+				if ((s & u8FlipH) && (dCur == Lt || dCur == Rt))
+				{
+					dCur = dCur == Lt ? Rt : Lt;
+				}
+				if ((s & u8FlipV) && (dCur == Up || dCur == Dn))
+				{
+					dCur = dCur == Up ? Dn : Up;
+				}
+				arrRet[s][d] = dCur;
+			}
+		}
+		return arrRet;
+	}();
+
+	//反向映射：变换后的方向对应原棋盘上的方向
+	constexpr const static inline auto arrUnmapDir = [](void) -> std::array<std::array<Direction, Direction::Enum_End>, u8SymCount>
+	{
+		std::array<std::array<Direction, Direction::Enum_End>, u8SymCount> arrRet{};
+		for (uint8_t s = 0; s < u8SymCount; ++s)
+		{
+			for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+			{
+				arrRet[s][arrMapDir[s][d]] = (Direction)d;
+			}
+		}
+		return arrRet;
+	}();
+
+public:
+	//每行内4个格子倒序
+	constexpr static BitBoard FlipH(const BitBoard &bbBoard) noexcept
+	{
+		uint64_t x = bbBoard.GetRaw();
+		x = ((x & 0x0F0F'0F0F'0F0F'0F0F) << 4) | ((x >> 4) & 0x0F0F'0F0F'0F0F'0F0F);
+		x = ((x & 0x00FF'00FF'00FF'00FF) << 8) | ((x >> 8) & 0x00FF'00FF'00FF'00FF);
+		return BitBoard{ x };
+	}
+
+	//4行倒序
+	constexpr static BitBoard FlipV(const BitBoard &bbBoard) noexcept
+	{
+		uint64_t x = bbBoard.GetRaw();
+		x = ((x & 0x0000'FFFF'0000'FFFF) << 16) | ((x >> 16) & 0x0000'FFFF'0000'FFFF);
+		x = (x << 32) | (x >> 32);
+		return BitBoard{ x };
+	}
+
+	constexpr static BitBoard Apply(const BitBoard &bbBoard, uint8_t u8Sym) noexcept
+	{
+		BitBoard bbRet = (u8Sym & u8Transpose) ? bbBoard.Transpose() : bbBoard;
+		bbRet = (u8Sym & u8FlipH) ? FlipH(bbRet) : bbRet;
+		bbRet = (u8Sym & u8FlipV) ? FlipV(bbRet) : bbRet;
+		return bbRet;
+	}
+
+	//Apply的逆变换：Invert(Apply(bb, s), s) == bb
+	constexpr static BitBoard Invert(const BitBoard &bbBoard, uint8_t u8Sym) noexcept
+	{
+		BitBoard bbRet = (u8Sym & u8FlipV) ? FlipV(bbBoard) : bbBoard;
+		bbRet = (u8Sym & u8FlipH) ? FlipH(bbRet) : bbRet;
+		bbRet = (u8Sym & u8Transpose) ? bbRet.Transpose() : bbRet;
+		return bbRet;
+	}
+
+	//原棋盘上的方向d，在Apply(bb, s)上对应的方向
+	constexpr static Direction MapDirection(Direction dMove, uint8_t u8Sym) noexcept
+	{
+		return arrMapDir[u8Sym][dMove];
+	}
+
+	//Apply(bb, s)上的方向d，在原棋盘上对应的方向（例如把规范形式上查到的最佳方向换回来）
+	constexpr static Direction UnmapDirection(Direction dMove, uint8_t u8Sym) noexcept
+	{
+		return arrUnmapDir[u8Sym][dMove];
+	}
+
+	//合法方向掩码同样可以换算，第d位移到MapDirection(d, s)位
+	constexpr static uint8_t MapLegalMask(uint8_t u8Legal, uint8_t u8Sym) noexcept
+	{
+		uint8_t u8Ret = 0;
+		for (Direction_Raw d = 0; d < Direction::Enum_End; ++d)
+		{
+			u8Ret |= ((u8Legal >> d) & 1) << arrMapDir[u8Sym][d];
+		}
+		return u8Ret;
+	}
+
+	//一次求出全部8个变换，u64Out[s] == Apply(bb, s).GetRaw()：转置前后各4个翻转结果，都是几次移位与掩码
+	constexpr static void ApplyAll(const BitBoard &bbBoard, uint64_t (&u64Out)[u8SymCount]) noexcept
+	{
+		BitBoard bbTrans = bbBoard.Transpose();
+		u64Out[0] = bbBoard.GetRaw();
+		u64Out[1] = FlipH(bbBoard).GetRaw();
+		u64Out[2] = FlipV(bbBoard).GetRaw();
+		u64Out[3] = FlipV(FlipH(bbBoard)).GetRaw();
+		u64Out[4] = bbTrans.GetRaw();
+		u64Out[5] = FlipH(bbTrans).GetRaw();
+		u64Out[6] = FlipV(bbTrans).GetRaw();
+		u64Out[7] = FlipV(FlipH(bbTrans)).GetRaw();
+	}
+
+	//8个变换中原始值最小的一个
+	//最小值的位置对随机局面无规律，比较写成条件传送而不是分支
+	constexpr static Canonical Canonicalize(const BitBoard &bbBoard) noexcept
+	{
+		uint64_t u64Cand[u8SymCount];
+		ApplyAll(bbBoard, u64Cand);
+
+		uint64_t u64Min = u64Cand[0];
+		uint8_t u8Sym = 0;
+		for (uint8_t s = 1; s < u8SymCount; ++s)
+		{
+			bool bLess = u64Cand[s] < u64Min;
+			u64Min = bLess ? u64Cand[s] : u64Min;
+			u8Sym = bLess ? s : u8Sym;
+		}
+		return Canonical{ BitBoard{ u64Min }, u8Sym };
+	}
+
+	//只要规范形式：不记录变换编号，8种变换由转置和两次翻转组合得到，每种只算一次
+	constexpr static BitBoard CanonicalBoard(const BitBoard &bbBoard) noexcept
+	{
+		BitBoard bbTrans = bbBoard.Transpose();
+		uint64_t u64Min = bbBoard.GetRaw();
+		for (const BitBoard &bbCur : { bbBoard, bbTrans })
+		{
+			BitBoard bbH = FlipH(bbCur);
+			BitBoard bbV = FlipV(bbCur);
+			BitBoard bbHV = FlipV(bbH);
+			uint64_t u64A = bbCur.GetRaw() < bbH.GetRaw() ? bbCur.GetRaw() : bbH.GetRaw();
+			uint64_t u64B = bbV.GetRaw() < bbHV.GetRaw() ? bbV.GetRaw() : bbHV.GetRaw();
+			u64A = u64A < u64B ? u64A : u64B;
+			u64Min = u64A < u64Min ? u64A : u64Min;
+		}
+		return BitBoard{ u64Min };
+	}
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <vector>
+
+/*
+多线程共享的无锁置换表:
+
+固定大小，每个桶正好一条缓存行（64字节），放4项，查找与写入都只碰一条缓存行
+每项两个64位字：数据（估值、深度、代数）与"键异或数据"，读写都是单个字的relaxed原子操作，不加锁
+两个线程同时写同一项时可能读到一个字新一个字旧，此时键异或数据对不上，按未命中处理（Hyatt的无锁哈希）
+代数用于老化：每次新搜索开始时加一，写入时优先替换旧代数与深度浅的项
+多个搜索共用的表保留之前代数的项（结果取决于调度，本来就不可复现）；
+单个搜索独占的表只认当前代数的项，旧项视为空项，代数回绕时清空，每次搜索的结果只取决于搜索本身
+*/
+class Transposition_Table
+{
+public:
+	constexpr const static inline size_t szBucketEntries = 4;
+
+private:
+	struct Entry
+	{
+		std::atomic<uint64_t> atCheck;//键异或数据
+		std::atomic<uint64_t> atData;//[63:32]估值 [31:16]深度 [15:8]代数 [0]有效
+	};
+
+	struct alignas(64) Bucket
+	{
+		Entry enArr[szBucketEntries];
+	};
+	static_assert(sizeof(Bucket) == 64, "a bucket must be exactly one cache line");
+
+	constexpr const static inline uint64_t u64ValidBit = 1;
+
+	std::vector<Bucket> vecBucket;
+	uint64_t u64BucketMask;
+	std::atomic<uint8_t> atGeneration;
+	bool bKeepOld;//之前代数的项是否可用
+
+private:
+	static uint64_t Pack(float fValue, uint16_t u16Depth, uint8_t u8Gen) noexcept
+	{
+		uint32_t u32Bits = 0;
+		memcpy(&u32Bits, &fValue, sizeof(u32Bits));
+		return ((uint64_t)u32Bits << 32) | ((uint64_t)u16Depth << 16) | ((uint64_t)u8Gen << 8) | u64ValidBit;
+	}
+
+	static float UnpackValue(uint64_t u64Data) noexcept
+	{
+		uint32_t u32Bits = (uint32_t)(u64Data >> 32);
+		float fValue = 0.0f;
+		memcpy(&fValue, &u32Bits, sizeof(fValue));
+		return fValue;
+	}
+
+	static uint16_t UnpackDepth(uint64_t u64Data) noexcept
+	{
+		return (uint16_t)(u64Data >> 16);
+	}
+
+	//这一项是否可用：有效，并且保留旧项或者属于当前代数
+	bool Usable(uint64_t u64Data, uint8_t u8Gen) const noexcept
+	{
+		return (u64Data & u64ValidBit) && (bKeepOld || UnpackGen(u64Data) == u8Gen);
+	}
+
+	static uint8_t UnpackGen(uint64_t u64Data) noexcept
+	{
+		return (uint8_t)(u64Data >> 8);
+	}
+
+	//乘法散列取高位
+	Bucket &BucketOf(uint64_t u64Key) noexcept
+	{
+		return vecBucket[(size_t)((u64Key * 0x9E37'79B9'7F4A'7C15) >> 32) & u64BucketMask];
+	}
+
+	const Bucket &BucketOf(uint64_t u64Key) const noexcept
+	{
+		return vecBucket[(size_t)((u64Key * 0x9E37'79B9'7F4A'7C15) >> 32) & u64BucketMask];
+	}
+
+public:
+	//一共2^u64EntryBits项（至少一个桶），bKeepOld为false时每一代只能查到这一代写入的项
+	explicit Transposition_Table(uint64_t u64EntryBits, bool _bKeepOld = true) :
+		vecBucket(u64EntryBits > 2 ? (size_t)1 << (u64EntryBits - 2) : 1),
+		u64BucketMask((u64EntryBits > 2 ? (uint64_t)1 << (u64EntryBits - 2) : 1) - 1),
+		atGeneration(0),
+		bKeepOld(_bKeepOld)
+	{}
+	~Transposition_Table(void) = default;
+
+	Transposition_Table(const Transposition_Table &) = delete;
+	Transposition_Table &operator=(const Transposition_Table &) = delete;
+
+	uint64_t EntryCount(void) const noexcept
+	{
+		return (uint64_t)vecBucket.size() * szBucketEntries;
+	}
+
+	//新一次搜索开始，之前写入的项在替换时让位
+	//只认当前代数时，回绕到0会让256代之前的项重新可用，此时清空（这种表只有一个线程在用）
+	uint8_t NewGeneration(void) noexcept
+	{
+		uint8_t u8Gen = atGeneration.fetch_add(1, std::memory_order_relaxed) + 1;
+		if (!bKeepOld && u8Gen == 0)
+		{
+			Clear();
+		}
+		return u8Gen;
+	}
+
+	//找到键相同且深度不小于u16MinDepth的项则写入fValue并返回true
+	bool Lookup(uint64_t u64Key, uint16_t u16MinDepth, float &fValue) const noexcept
+	{
+		uint8_t u8Gen = atGeneration.load(std::memory_order_relaxed);
+		const Bucket &bkCur = BucketOf(u64Key);
+		for (const Entry &enCur : bkCur.enArr)
+		{
+			uint64_t u64Data = enCur.atData.load(std::memory_order_relaxed);
+			uint64_t u64Check = enCur.atCheck.load(std::memory_order_relaxed);
+			if ((u64Check ^ u64Data) != u64Key || !Usable(u64Data, u8Gen))
+			{
+				continue;
+			}
+
+			if (UnpackDepth(u64Data) < u16MinDepth)
+			{
+				return false;
+			}
+			fValue = UnpackValue(u64Data);
+			return true;
+		}
+		return false;
+	}
+
+	//同一个键只保留一项（新结果不更浅时覆盖），否则替换空项或者最旧、最浅的一项
+	void Store(uint64_t u64Key, uint16_t u16Depth, float fValue) noexcept
+	{
+		uint8_t u8Gen = atGeneration.load(std::memory_order_relaxed);
+		Bucket &bkCur = BucketOf(u64Key);
+
+		//先扫完整个桶找同一局面，找不到再依次选空项或旧项、优先级最低的项
+		//遇到空项就停会让后面的同一局面留下一份重复的旧结果
+		Entry *pSame = NULL;
+		Entry *pFree = NULL;
+		Entry *pVictim = &bkCur.enArr[0];
+		int64_t i64VictimPriority = INT64_MAX;
+		for (Entry &enCur : bkCur.enArr)
+		{
+			uint64_t u64Data = enCur.atData.load(std::memory_order_relaxed);
+			uint64_t u64Check = enCur.atCheck.load(std::memory_order_relaxed);
+			if (!Usable(u64Data, u8Gen))//空项，或者不再可用的旧项
+			{
+				pFree = pFree == NULL ? &enCur : pFree;
+				continue;
+			}
+
+			if ((u64Check ^ u64Data) == u64Key)
+			{
+				if (UnpackDepth(u64Data) > u16Depth)//已经有更深的结果
+				{
+					return;
+				}
+				pSame = &enCur;
+				break;
+			}
+
+			//每老一代相当于浅4层
+			int64_t i64Priority = (int64_t)UnpackDepth(u64Data) - 4 * (int64_t)(uint8_t)(u8Gen - UnpackGen(u64Data));
+			if (i64Priority < i64VictimPriority)
+			{
+				i64VictimPriority = i64Priority;
+				pVictim = &enCur;
+			}
+		}
+		pVictim = pSame != NULL ? pSame : (pFree != NULL ? pFree : pVictim);
+
+		uint64_t u64Data = Pack(fValue, u16Depth, u8Gen);
+		pVictim->atCheck.store(u64Key ^ u64Data, std::memory_order_relaxed);
+		pVictim->atData.store(u64Data, std::memory_order_relaxed);
+	}
+
+	//清空，不能与查找、写入同时进行
+	void Clear(void) noexcept
+	{
+		for (Bucket &bkCur : vecBucket)
+		{
+			for (Entry &enCur : bkCur.enArr)
+			{
+				enCur.atCheck.store(0, std::memory_order_relaxed);
+				enCur.atData.store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+#include "Game_Board.hpp"
+#include "Game_Random.hpp"
+#include "Game_BatchMove.hpp"
+
+/*
+强化学习用的向量化环境:
+
+同时持有N局4*4游戏，按字段分别存成数组（棋盘、随机数流、得分、合法方向掩码），不为每局构造对象
+Reset与Step把观测、奖励、结束标志与合法方向掩码直接写进调用者给的缓冲区，每步不分配内存、不拷贝局面
+移动用Batch_Move每次批量处理一组棋盘，之后生成数字的顺序与Game2048_Engine完全相同：
+用同一个种子，这里的一局与Game2048_Engine<>(种子)按相同动作玩出的局面逐位一致
+与交互界面一样，赢（合成2048）或输之后这一局自动重开，新的一局接着用这一局的随机数流
+
+缓冲区布局（i为局号）：
+	观测	uint8_t [N][u64Planes][u64Cells]，第e个平面上指数为e的格子为1，其余为0（平面0即空格）
+	奖励	float [N]，这一步的合并得分，非法动作为0
+	结束	uint8_t [N]，这一步之后这一局结束（已经自动重开）为1
+	合法	uint8_t [N]，当前局面（重开后则为新局面）的合法方向掩码，第d位对应Direction d
+*/
+class Vector_Env
+{
+public:
+	constexpr const static inline uint64_t u64Cells = BitBoard::u64TotalSize;
+	constexpr const static inline uint64_t u64Planes = BitBoard::u8MaxExp + 1;
+	constexpr const static inline uint64_t u64ObsSize = u64Planes * u64Cells;//每局观测的字节数
+	constexpr const static inline uint8_t u8WinExp = 11;//2048的指数
+
+private:
+	uint64_t u64Count;
+	uint64_t u64Spawn4Threshold;
+
+	std::vector<BitBoard> vecBoard;
+	std::vector<Rand_Counter> vecRand;
+	std::vector<uint64_t> vecScore;//这一局到目前为止的得分
+	std::vector<uint8_t> vecLegal;
+
+private:
+	//与Game2048_Engine::SpawnRandomTile相同：先选空格再选数字，然后重新计算合法方向
+	void SpawnRandomTile(uint64_t i) noexcept
+	{
+		Rand_Counter &randGen = vecRand[i];
+		uint64_t u64Index = vecBoard[i].PickEmpty([&randGen](uint64_t u64EmptyCount) -> uint64_t
+		{
+			return randGen.Below(u64EmptyCount);
+		});
+		if (u64Index == BitBoard::u64TotalSize)
+		{
+			return;
+		}
+
+		vecBoard[i].SetExp(u64Index, randGen.Next() < u64Spawn4Threshold ? 2 : 1);
+		vecLegal[i] = vecBoard[i].LegalMoves();
+	}
+
+	void ResetOne(uint64_t i) noexcept
+	{
+		vecBoard[i] = BitBoard{};
+		vecScore[i] = 0;
+		SpawnRandomTile(i);
+		SpawnRandomTile(i);
+	}
+
+	void WriteObs(uint64_t i, uint8_t *pObs) const noexcept
+	{
+		uint8_t *pCur = pObs + i * u64ObsSize;
+		memset(pCur, 0, u64ObsSize);
+		for (uint64_t c = 0; c < u64Cells; ++c)
+		{
+			pCur[vecBoard[i].GetExp(c) * u64Cells + c] = 1;
+		}
+	}
+
+public:
+	Vector_Env(uint64_t _u64Count, double dSpawnWeights_2 = 0.9, double dSpawnWeights_4 = 0.1) :
+		u64Count(_u64Count),
+		u64Spawn4Threshold(Game2048_Random::ProbToThreshold(dSpawnWeights_4 / (dSpawnWeights_2 + dSpawnWeights_4))),
+		vecBoard(_u64Count),
+		vecRand(_u64Count),
+		vecScore(_u64Count, 0),
+		vecLegal(_u64Count, 0)
+	{
+		MoveTable::Get();
+	}
+	~Vector_Env(void) = default;
+
+	Vector_Env(const Vector_Env &) = delete;
+	Vector_Env &operator=(const Vector_Env &) = delete;
+
+	uint64_t Size(void) const noexcept
+	{
+		return u64Count;
+	}
+
+	//所有局重开，第i局使用种子pSeeds[i]（与Game2048_Engine<>(种子)相同的随机数流）
+	//pSeeds为NULL时各局接着用自己现在的随机数流；pObs与pLegal可以为NULL
+	void Reset(const uint64_t *pSeeds, uint8_t *pObs, uint8_t *pLegal) noexcept
+	{
+		for (uint64_t i = 0; i < u64Count; ++i)
+		{
+			if (pSeeds != NULL)
+			{
+				vecRand[i] = Rand_Counter{ pSeeds[i] };
+			}
+			ResetOne(i);
+
+			if (pObs != NULL)
+			{
+				WriteObs(i, pObs);
+			}
+			if (pLegal != NULL)
+			{
+				pLegal[i] = vecLegal[i];
+			}
+		}
+	}
+
+	//第i局执行动作pActions[i]（Direction的值，非法或越界的动作不改变局面）
+	//pEpisodeScore不为NULL时，结束的局在其中写入这一局的总得分，其余局不写；返回这一步结束的局数
+	uint64_t Step(const uint8_t *pActions, uint8_t *pObs, float *pReward, uint8_t *pDone, uint8_t *pLegal, uint64_t *pEpisodeScore) noexcept
+	{
+		uint64_t u64Finished = 0;
+
+		BitBoard bbMoved[Batch_Move::szMaxBoards];
+		uint32_t u32Score[Batch_Move::szMaxBoards];
+		Direction dMove[Batch_Move::szMaxBoards];
+		for (uint64_t u64Beg = 0; u64Beg < u64Count; u64Beg += Batch_Move::szMaxBoards)
+		{
+			uint64_t u64Group = u64Count - u64Beg < Batch_Move::szMaxBoards ? u64Count - u64Beg : Batch_Move::szMaxBoards;
+			for (uint64_t j = 0; j < u64Group; ++j)
+			{
+				uint8_t u8Action = pActions[u64Beg + j];
+				dMove[j] = u8Action < Direction::Enum_End ? (Direction)u8Action : Up;
+			}
+			uint64_t u64Moved = Batch_Move::Move(&vecBoard[u64Beg], dMove, bbMoved, u32Score, u64Group);
+
+			for (uint64_t j = 0; j < u64Group; ++j)
+			{
+				uint64_t i = u64Beg + j;
+				bool bMoved = pActions[i] < Direction::Enum_End && (u64Moved & ((uint64_t)1 << j)) != 0;
+				bool bDone = false;
+				if (bMoved)
+				{
+					vecBoard[i] = bbMoved[j];//合法方向在生成数字后更新，移动之后一定有空格
+					vecScore[i] += u32Score[j];
+
+					//每局赢了就重开，局面上出现2048只可能是这一步刚合成的
+					if (bbMoved[j].MaxExp() >= u8WinExp)
+					{
+						bDone = true;
+					}
+					else
+					{
+						SpawnRandomTile(i);
+						bDone = vecLegal[i] == 0;
+					}
+				}
+
+				if (pReward != NULL)
+				{
+					pReward[i] = bMoved ? (float)u32Score[j] : 0.0f;
+				}
+				if (pDone != NULL)
+				{
+					pDone[i] = bDone;
+				}
+				if (bDone)
+				{
+					if (pEpisodeScore != NULL)
+					{
+						pEpisodeScore[i] = vecScore[i];
+					}
+					ResetOne(i);
+					++u64Finished;
+				}
+
+				if (pObs != NULL)
+				{
+					WriteObs(i, pObs);
+				}
+				if (pLegal != NULL)
+				{
+					pLegal[i] = vecLegal[i];
+				}
+			}
+		}
+
+		return u64Finished;
+	}
+
+	//====================单局查询====================
+	const BitBoard &GetBoard(uint64_t i) const noexcept
+	{
+		return vecBoard[i];
+	}
+
+	uint64_t GetScore(uint64_t i) const noexcept
+	{
+		return vecScore[i];
+	}
+
+	uint8_t LegalMoves(uint64_t i) const noexcept
+	{
+		return vecLegal[i];
+	}
+};
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "Game_Replay.hpp"
+#include "Thread_Pool.hpp"
+
+/*
+并行回放校验:
+
+输入为一个回放文件、一个目录（其中所有普通文件按文件名顺序处理）或标准输入（"-"），
+每个输入先顺序扫描出记录边界，再按固定大小的分块提交到工作窃取线程池重放，
+全部完成后按输入顺序输出每条记录的结果：是否合法、重放得分与声明得分、最终状态与棋盘
+生成权重不是标准的0.9/0.1的记录（例如从不生成4）直接视为不合法，不重放
+记录数量很大时按窗口分批处理，内存占用与输入大小无关
+*/
+class Replay_Verifier
+{
+public:
+	struct Config
+	{
+		uint64_t u64Threads = 0;//线程数，0代表使用所有核心
+		bool bQuiet = false;//只输出被拒绝的记录与汇总
+	};
+
+	struct Summary
+	{
+		uint64_t u64Inputs = 0;//处理的输入数
+		uint64_t u64Records = 0;//记录总数
+		uint64_t u64Accepted = 0;//移动合法且得分一致
+		uint64_t u64Illegal = 0;//存在不合法移动
+		uint64_t u64ScoreMismatch = 0;//移动合法但得分不一致
+		uint64_t u64FormatErrors = 0;//格式错误（截断、魔数不符）的输入数
+		uint64_t u64Moves = 0;//重放的移动总数
+	};
+
+private:
+	constexpr const static inline size_t szWindowRecords = (size_t)1 << 16;//每批最多处理的记录数，每条结果带一个最大16*16的棋盘
+	constexpr const static inline size_t szChunkRecords = 64;//每个任务处理的记录数
+
+	const Config &cfgVerify;
+	Thread_Pool tpWorkers;
+	Summary smTotal;
+
+	//每批复用，避免反复分配
+	std::vector<Replay_Record> vecRecord;
+	std::vector<Replay_Player::Outcome> vecOutcome;
+
+private:
+	static const char *StatusName(GameStatus enStatus) noexcept
+	{
+		switch (enStatus)
+		{
+		case InGame:
+			return "ingame";
+		case WinGame:
+			return "win";
+		case LostGame:
+			return "lost";
+		default:
+			return "unknown";
+		}
+	}
+
+	//棋盘按行输出指数（32进制，0~9再接a~v），行之间用'/'分隔，0为空格
+	static void PrintBoard(const Replay_Player::Outcome &ocGame)
+	{
+		char cBuf[Replay_Player::u64MaxCells * 2 + 1];
+		size_t szLen = 0;
+		if ((uint64_t)ocGame.u8Width * ocGame.u8Height > Replay_Player::u64MaxCells)//不支持的尺寸来自文件头，没有棋盘可输出
+		{
+			return;
+		}
+		for (uint64_t Y = 0; Y < ocGame.u8Height; ++Y)
+		{
+			if (Y != 0)
+			{
+				cBuf[szLen++] = '/';
+			}
+			for (uint64_t X = 0; X < ocGame.u8Width; ++X)
+			{
+				cBuf[szLen++] = "0123456789abcdefghijklmnopqrstuv"[ocGame.u8Exp[Y * ocGame.u8Width + X] & 0x1F];
+			}
+		}
+		cBuf[szLen] = '\0';
+		fputs(cBuf, stdout);
+	}
+
+	void ReportWindow(const char *pName)
+	{
+		for (size_t i = 0; i < vecRecord.size(); ++i)
+		{
+			const Replay_Record &rrGame = vecRecord[i];
+			const Replay_Player::Outcome &ocGame = vecOutcome[i];
+
+			bool bAccepted = ocGame.bLegal && ocGame.bScoreMatch;
+			++smTotal.u64Records;
+			smTotal.u64Accepted += bAccepted;
+			smTotal.u64Illegal += !ocGame.bLegal;
+			smTotal.u64ScoreMismatch += ocGame.bLegal && !ocGame.bScoreMatch;
+			smTotal.u64Moves += ocGame.u64FirstIllegal;
+
+			if (cfgVerify.bQuiet && bAccepted)
+			{
+				continue;
+			}
+
+			printf("record input=%s offset=%llu accepted=%d legal=%d moves=%llu/%llu score=%llu claimed=%llu status=%s board=",
+				pName,
+				(unsigned long long)rrGame.u64Offset,
+				bAccepted ? 1 : 0,
+				ocGame.bLegal ? 1 : 0,
+				(unsigned long long)ocGame.u64FirstIllegal,
+				(unsigned long long)rrGame.u64MoveCount,
+				(unsigned long long)ocGame.u64Score,
+				(unsigned long long)rrGame.u64ClaimedScore,
+				StatusName(ocGame.enStatus));
+			PrintBoard(ocGame);
+			putchar('\n');
+		}
+	}
+
+	//重放当前窗口中的所有记录，结果写入对应下标
+	void RunWindow(void)
+	{
+		vecOutcome.resize(vecRecord.size());
+		for (size_t szBeg = 0; szBeg < vecRecord.size(); szBeg += szChunkRecords)
+		{
+			size_t szEnd = std::min(szBeg + szChunkRecords, vecRecord.size());
+			tpWorkers.Submit([this, szBeg, szEnd](void) -> void
+			{
+				for (size_t i = szBeg; i < szEnd; ++i)
+				{
+					const Replay_Record &rrGame = vecRecord[i];
+					if (!Replay_Format::CanonicalWeights(rrGame.dSpawnWeights_2, rrGame.dSpawnWeights_4))
+					{
+						vecOutcome[i] = Replay_Player::Outcome{};
+						vecOutcome[i].u8Width = rrGame.u8Width;
+						vecOutcome[i].u8Height = rrGame.u8Height;
+						continue;
+					}
+					vecOutcome[i] = Replay_Player::Simulate(rrGame);
+				}
+			});
+		}
+		tpWorkers.Wait();
+	}
+
+	void VerifyBuffer(const char *pName, const uint8_t *pData, size_t szSize)
+	{
+		++smTotal.u64Inputs;
+
+		Replay_Reader rdInput{ pData, szSize };
+		Replay_Record rrGame{};
+		while (true)
+		{
+			vecRecord.clear();
+			while (vecRecord.size() < szWindowRecords && rdInput.Next(rrGame))
+			{
+				vecRecord.push_back(rrGame);
+			}
+			if (vecRecord.empty())
+			{
+				break;
+			}
+
+			RunWindow();
+			ReportWindow(pName);
+		}
+
+		if (rdInput.HasError())
+		{
+			++smTotal.u64FormatErrors;
+			printf("format_error input=%s offset=%llu\n", pName, (unsigned long long)rdInput.GetPosition());
+		}
+	}
+
+	bool VerifyFile(const char *pPath)
+	{
+		Replay_File rfInput{};
+		if (!rfInput.Open(pPath))
+		{
+			fprintf(stderr, "Error: cannot open replay file %s\n", pPath);
+			return false;
+		}
+
+		VerifyBuffer(pPath, rfInput.Data(), rfInput.Size());
+		return true;
+	}
+
+	//标准输入不能映射，整体读入内存
+	bool VerifyStdin(void)
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+		std::vector<uint8_t> vecData;
+		uint8_t u8Buf[65536];
+		size_t szRead = 0;
+		while ((szRead = fread(u8Buf, 1, sizeof(u8Buf), stdin)) != 0)
+		{
+			vecData.insert(vecData.end(), u8Buf, u8Buf + szRead);
+		}
+
+		VerifyBuffer("-", vecData.data(), vecData.size());
+		return true;
+	}
+
+public:
+	explicit Replay_Verifier(const Config &_cfgVerify) :
+		cfgVerify(_cfgVerify),
+		tpWorkers(_cfgVerify.u64Threads),
+		smTotal(),
+		vecRecord(),
+		vecOutcome()
+	{}
+	~Replay_Verifier(void) = default;
+
+	//校验一个输入：文件、目录或"-"，无法打开时返回false
+	bool Verify(const char *pPath)
+	{
+		if (strcmp(pPath, "-") == 0)
+		{
+			return VerifyStdin();
+		}
+
+		std::error_code ecDir{};
+		if (!std::filesystem::is_directory(pPath, ecDir))
+		{
+			return VerifyFile(pPath);
+		}
+
+		//目录中的文件按名字排序，输出顺序可以复现
+		std::vector<std::filesystem::path> vecPath;
+		for (const auto &it : std::filesystem::directory_iterator(pPath, ecDir))
+		{
+			if (it.is_regular_file())
+			{
+				vecPath.push_back(it.path());
+			}
+		}
+		std::sort(vecPath.begin(), vecPath.end());
+
+		bool bRet = true;
+		for (const auto &it : vecPath)
+		{
+			bRet &= VerifyFile(it.string().c_str());
+		}
+		return bRet;
+	}
+
+	const Summary &GetSummary(void) const noexcept
+	{
+		return smTotal;
+	}
+
+	uint64_t GetThreadCount(void) const noexcept
+	{
+		return tpWorkers.GetThreadCount();
+	}
+
+	//命令行入口：game2048 --verify <file|dir|-> [--threads N] [--quiet]
+	static int Main(int argc, char *argv[])
+	{
+		auto Usage = [&](void) -> int
+		{
+			fprintf(stderr, "Usage: %s --verify <file|dir|-> [--threads N] [--quiet]\n", argv[0]);
+			return 1;
+		};
+
+		if (argc < 3)
+		{
+			return Usage();
+		}
+
+		Config cfgVerify{};
+		for (int i = 3; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			{
+				cfgVerify.u64Threads = strtoull(argv[++i], NULL, 10);
+			}
+			else if (strcmp(argv[i], "--quiet") == 0)
+			{
+				cfgVerify.bQuiet = true;
+			}
+			else
+			{
+				return Usage();
+			}
+		}
+
+		auto tpBeg = std::chrono::steady_clock::now();
+
+		Replay_Verifier rvMain{ cfgVerify };
+		bool bOpened = rvMain.Verify(argv[2]);
+
+		auto tpEnd = std::chrono::steady_clock::now();
+		double dSeconds = std::chrono::duration<double>(tpEnd - tpBeg).count();
+
+		const Summary &smTotal = rvMain.GetSummary();
+		printf("threads=%llu\n", (unsigned long long)rvMain.GetThreadCount());
+		printf("inputs=%llu\n", (unsigned long long)smTotal.u64Inputs);
+		printf("records=%llu\n", (unsigned long long)smTotal.u64Records);
+		printf("accepted=%llu\n", (unsigned long long)smTotal.u64Accepted);
+		printf("illegal=%llu\n", (unsigned long long)smTotal.u64Illegal);
+		printf("score_mismatch=%llu\n", (unsigned long long)smTotal.u64ScoreMismatch);
+		printf("format_errors=%llu\n", (unsigned long long)smTotal.u64FormatErrors);
+		printf("moves=%llu\n", (unsigned long long)smTotal.u64Moves);
+		printf("seconds=%.3f\n", dSeconds);
+		printf("records_per_second=%.1f\n", dSeconds > 0.0 ? (double)smTotal.u64Records / dSeconds : 0.0);
+
+		return bOpened && smTotal.u64Records == smTotal.u64Accepted && smTotal.u64FormatErrors == 0 ? 0 : 1;
+	}
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+
+/*
+工作窃取线程池:
+
+每个工作线程有自己的任务队列，自己从队尾取（后进先出，缓存更热），
+自己的队列空了就从其它线程的队首偷（先进先出，偷走的是较早、通常较大的任务）
+外部线程提交的任务轮流放进各个队列，工作线程内部提交的任务放进自己的队列
+Wait等待所有已提交的任务（包括任务中再提交的任务）执行完毕
+*/
+class Thread_Pool
+{
+public:
+	using Task = std::function<void(void)>;
+
+private:
+	//每个队列独占缓存行，避免不同线程的锁互相干扰
+	struct alignas(64) WorkerQueue
+	{
+		std::mutex mtx;
+		std::deque<Task> deqTask;
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> vecQueue;
+	std::vector<std::thread> vecThread;
+
+	std::atomic<uint64_t> atQueued;//已入队还未被取走的任务数
+	std::atomic<uint64_t> atPending;//已提交还未执行完的任务数
+	std::atomic<uint64_t> atNextQueue;//外部提交时轮流选择的队列
+
+	std::mutex mtxWake;//只用于条件变量的等待与唤醒
+	std::condition_variable cvWake;//有新任务或需要退出
+	std::condition_variable cvDone;//所有任务执行完毕
+	bool bStop;
+
+	//当前线程所属的线程池与序号，不是工作线程时为NULL
+	static inline thread_local Thread_Pool *pCurPool = NULL;
+	static inline thread_local size_t szCurIndex = 0;
+
+private:
+	bool PopLocal(size_t szIndex, Task &tOut)
+	{
+		WorkerQueue &wqSelf = *vecQueue[szIndex];
+		std::lock_guard<std::mutex> lgQueue{ wqSelf.mtx };
+		if (wqSelf.deqTask.empty())
+		{
+			return false;
+		}
+
+		tOut = std::move(wqSelf.deqTask.back());
+		wqSelf.deqTask.pop_back();
+		return true;
+	}
+
+	bool Steal(size_t szIndex, Task &tOut)
+	{
+		for (size_t i = 1; i < vecQueue.size(); ++i)
+		{
+			WorkerQueue &wqVictim = *vecQueue[(szIndex + i) % vecQueue.size()];
+			std::lock_guard<std::mutex> lgQueue{ wqVictim.mtx };
+			if (wqVictim.deqTask.empty())
+			{
+				continue;
+			}
+
+			tOut = std::move(wqVictim.deqTask.front());
+			wqVictim.deqTask.pop_front();
+			return true;
+		}
+
+		return false;
+	}
+
+	void WorkerMain(size_t szIndex)
+	{
+		pCurPool = this;
+		szCurIndex = szIndex;
+
+		Task tCur{};
+		while (true)
+		{
+			if (PopLocal(szIndex, tCur) || Steal(szIndex, tCur))
+			{
+				atQueued.fetch_sub(1, std::memory_order_relaxed);
+				tCur();
+				tCur = nullptr;
+
+				//最后一个任务执行完，唤醒Wait
+				if (atPending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					std::lock_guard<std::mutex> lgWake{ mtxWake };
+					cvDone.notify_all();
+				}
+				continue;
+			}
+
+			std::unique_lock<std::mutex> ulWake{ mtxWake };
+			cvWake.wait(ulWake, [this](void) -> bool
+			{
+				return bStop || atQueued.load(std::memory_order_relaxed) != 0;
+			});
+			if (bStop && atQueued.load(std::memory_order_relaxed) == 0)
+			{
+				return;
+			}
+		}
+	}
+
+public:
+	//u64Threads为0时使用所有核心
+	explicit Thread_Pool(uint64_t u64Threads = 0) :
+		vecQueue(),
+		vecThread(),
+		atQueued(0),
+		atPending(0),
+		atNextQueue(0),
+		mtxWake(),
+		cvWake(),
+		cvDone(),
+		bStop(false)
+	{
+		if (u64Threads == 0)
+		{
+			u64Threads = std::thread::hardware_concurrency();
+			u64Threads = u64Threads == 0 ? 1 : u64Threads;
+		}
+
+		vecQueue.reserve(u64Threads);
+		for (uint64_t i = 0; i < u64Threads; ++i)
+		{
+			vecQueue.emplace_back(std::make_unique<WorkerQueue>());
+		}
+
+		vecThread.reserve(u64Threads);
+		for (uint64_t i = 0; i < u64Threads; ++i)
+		{
+			vecThread.emplace_back(&Thread_Pool::WorkerMain, this, (size_t)i);
+		}
+	}
+	~Thread_Pool(void)
+	{
+		{
+			std::lock_guard<std::mutex> lgWake{ mtxWake };
+			bStop = true;
+		}
+		cvWake.notify_all();
+
+		for (auto &it : vecThread)
+		{
+			it.join();
+		}
+	}
+
+	Thread_Pool(const Thread_Pool &) = delete;
+	Thread_Pool &operator=(const Thread_Pool &) = delete;
+
+	void Submit(Task tNew)
+	{
+		atPending.fetch_add(1, std::memory_order_relaxed);
+
+		size_t szIndex = pCurPool == this ? szCurIndex : (size_t)(atNextQueue.fetch_add(1, std::memory_order_relaxed) % vecQueue.size());
+		{
+			WorkerQueue &wqTarget = *vecQueue[szIndex];
+			std::lock_guard<std::mutex> lgQueue{ wqTarget.mtx };
+			wqTarget.deqTask.push_back(std::move(tNew));
+		}
+		atQueued.fetch_add(1, std::memory_order_relaxed);
+
+		//先拿一下锁再通知，保证等待中的线程不会错过这次唤醒
+		{
+			std::lock_guard<std::mutex> lgWake{ mtxWake };
+		}
+		cvWake.notify_one();
+	}
+
+	//等待所有任务完成，不能在工作线程中调用
+	void Wait(void)
+	{
+		std::unique_lock<std::mutex> ulWake{ mtxWake };
+		cvDone.wait(ulWake, [this](void) -> bool
+		{
+			return atPending.load(std::memory_order_acquire) == 0;
+		});
+	}
+
+	uint64_t GetThreadCount(void) const noexcept
+	{
+		return vecThread.size();
+	}
+};
@@ -1,14 +1,26 @@
 ﻿#include <stdio.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <array>
 #include <random>
-#include <span>
-#include <algorithm>
+
+#include "Game_Engine.hpp"
+#include "Game_Batch.hpp"
+#include "Console_Renderer.hpp"
+#include "Game_Replay.hpp"
+#include "Game_Verify.hpp"
+#include "Game_History.hpp"
+#include "Game_Stats.hpp"
+#include "Game_Coroutine.hpp"
+#include "Game_NTuple.hpp"
 
 #ifdef _WIN32
 #include "Console_Input.hpp"
 #elif defined(__linux__)
 #include "Console_Input_Linux.hpp"
+#include "Game_Server.hpp"
 #endif
 
 /*
@@ -34,332 +46,194 @@
 */
 
 
+template<uint64_t W = 4, uint64_t H = 4>//棋盘尺寸在编译期确定，打印与移动的循环都可以展开
 class Game2048
 {
+public:
+	using Input = Key_Channel<Console_Input::Key>;//这一局的按键通道，由调用者从任意输入源放入按键
+
 private:
-	using Direction_Raw = uint8_t;
-	enum Direction : Direction_Raw
-	{
-		Up = 0,
-		Dn,
-		Lt,
-		Rt,
-		Enum_End,
-	};
+	using Direction = ::Direction;
 
-	enum GameStatus
+	//按键回调的返回值
+	enum KeyResult : long
 	{
-		InGame = 0,
-		WinGame,
-		LostGame,
+		Key_None = 0,//没有变化
+		Key_Redraw = 1,//局面变化，需要重绘
+		Key_Restart,//请求重开，需要询问
+		Key_Quit,//请求退出，需要询问
 	};
 
-	struct Pos
-	{
-	public:
-		int64_t i64X, i64Y;
-
-	public:
-		Pos operator+(const Pos &_Right) const
-		{
-			return
-			{
-				i64X + _Right.i64X,
-				i64Y + _Right.i64Y,
-			};
-		}
-
-		Pos operator-(const Pos &_Right) const
-		{
-			return
-			{
-				i64X - _Right.i64X,
-				i64Y - _Right.i64Y,
-			};
-		}
-
-		Pos &operator+=(const Pos &_Right)
-		{
-			i64X += _Right.i64X;
-			i64Y += _Right.i64Y;
-
-			return *this;
-		}
+private:
+	using Engine = Game2048_Engine<W, H>;
 
-		Pos &operator-=(const Pos &_Right)
-		{
-			i64X -= _Right.i64X;
-			i64Y -= _Right.i64Y;
+	//历史中的一步：移动后的局面快照与这一步的方向（重做时要补记回放）
+	struct HistoryEntry
+	{
+		typename Engine::Snapshot snGame;
+		Direction dMove;
+	};
+	constexpr const static inline size_t szHistoryCapacity = 1024;//可撤销的步数上限
 
-			return *this;
-		}
+	constexpr const static inline uint64_t u64Width = Engine::u64Width;
+	constexpr const static inline uint64_t u64Height = Engine::u64Height;
 
-		bool operator==(const Pos &_Right) const
+	//每格的数字至少占4位，棋盘上出现更长的数字时整列一起变宽，最宽为这种棋盘能合并出的最大数字的位数
+	constexpr const static inline uint64_t u64MinCellDigits = 4;
+	constexpr const static inline uint64_t u64MaxCellDigits = [](void) -> uint64_t
+	{
+		uint64_t u64Digits = 1;
+		for (uint64_t u64Value = BitBoard::ExpToValue(Engine::Board::u8MaxExp); u64Value >= 10; u64Value /= 10)
 		{
-			return i64X == _Right.i64X && i64Y == _Right.i64Y;
+			++u64Digits;
 		}
+		return u64Digits > u64MinCellDigits ? u64Digits : u64MinCellDigits;
+	}();
+	//网格宽度：每格"|"加数字，最右边再加一个"|"
+	constexpr const static inline uint64_t u64MaxGridCols = u64Width * (u64MaxCellDigits + 1) + 1;
 
-		bool operator!=(const Pos &_Right) const
+	//边框线，按当前格子宽度截取前面一段
+	constexpr const static inline auto arrBorder = [](void) -> std::array<char, u64MaxGridCols + 1>
+	{
+		std::array<char, u64MaxGridCols + 1> arrRet{};
+		for (uint64_t i = 0; i < u64MaxGridCols; ++i)
 		{
-			return i64X != _Right.i64X || i64Y != _Right.i64Y;
+			arrRet[i] = '-';
 		}
-	};
+		return arrRet;
+	}();
 
-	constexpr const static inline Pos arrMoveDir[Direction::Enum_End] =
-	{
-		{ 0,-1},
-		{ 0, 1},
-		{-1, 0},
-		{ 1, 0},
-	};
+	Engine engGame;//游戏逻辑
+	uint64_t u64Seed;//主种子，记录回放用
+	double dSpawnWeights_2;//生成2的权重，记录回放用
+	double dSpawnWeights_4;//生成4的权重，记录回放用
 
-private:
-	constexpr const static inline uint64_t u64Width = 4;
-	constexpr const static inline uint64_t u64Height = 4;
-	constexpr const static inline uint64_t u64TotalSize = u64Width * u64Height;
-
-	uint64_t u64Tile[u64Height][u64Width];//空格子为0
-	const std::span<uint64_t, u64TotalSize> u64TileFlatView{ (uint64_t *)u64Tile, u64TotalSize };//提供二维数组的一维平坦视图
+	Undo_History<HistoryEntry, szHistoryCapacity> uhGame;//撤销与重做
 
-	uint64_t u64EmptyCount;//空余的的格子数
-	GameStatus enGameStatus;//游戏状态
+	Replay_Recorder rrGame;//回放记录器
+	FILE *fpRecord = NULL;//回放文件，为NULL时不记录
 	
 	uint16_t u16PrintStartX = 1;//打印起始位置X
 	uint16_t u16PrintStartY = 1;//打印起始位置Y
 
-	Console_Input ci;//按键注册
+	Console_Renderer crBoard;//棋盘区域的差量渲染，每帧只输出变化的格子
 
-	std::mt19937_64 randGen;//梅森旋转算法随机数生成器
-	std::discrete_distribution<uint64_t> valueDist;//值生成-离散分布
-	std::uniform_int_distribution<uint64_t> posDist;//坐标生成-均匀分布
+	Console_Input ci;//按键注册
 
 private:
-	//====================辅助函数====================
-	uint64_t &GetTile(const Pos &posTarget)
-	{
-		return u64Tile[posTarget.i64Y][posTarget.i64X];
-	}
-
-	uint64_t GenerateRandTileVal(void)
-	{
-		constexpr const static uint64_t u64PossibleValues[] = { 2, 4 };
-		return u64PossibleValues[valueDist(randGen)];
-	}
-
-	bool IsTilePosValid(const Pos &p) const
-	{
-		return	p.i64X >= 0 && p.i64X < u64Width &&
-				p.i64Y >= 0 && p.i64Y < u64Height;
-	}
-	
-	//====================刷出数字====================
-	bool HasPossibleMerges(void) const
-	{
-		//查找所有格子的相邻，如果没有任何相邻且数值相同的格子，那么游戏失败
-		for (uint64_t Y = 0; Y < u64Height; ++Y)
-		{
-			for (uint64_t X = 0; X < u64Width; ++X)
-			{
-				uint64_t u64Cur = u64Tile[Y][X];
-
-				//向右向下检测（避免越界）
-				if (X + 1 < u64Width && u64Tile[Y][X + 1] == u64Cur ||
-					Y + 1 < u64Height && u64Tile[Y + 1][X] == u64Cur)
-				{
-					return true; //有可合并的
-				}
-			}
-		}
-
-		//所有检测都没返回，那么不存在可合并情况，游戏失败
-		return false;
-	}
-
-	bool SpawnRandomTile(void)
+	//====================移动合并====================
+	bool ProcessMove(Direction dMove)
 	{
-		if (u64EmptyCount == 0)
+		if (!engGame.ProcessMove(dMove))
 		{
 			return false;
 		}
 
-		//还有空间，递减空格子数
-		--u64EmptyCount;
-
-		//在剩余格子中均匀生成
-		auto targetPos = posDist(randGen, decltype(posDist)::param_type(0, u64EmptyCount));
-
-		//遍历并找到第targetPos个格子
-		for (auto &it : u64TileFlatView)
-		{
-			if (it != 0)//不是空格，继续
-			{
-				continue;
-			}
-
-			if (targetPos != 0)//是空格，当前是目标位置吗
-			{
-				--targetPos;//不是就递减并继续
-				continue;
-			}
-
-			//是目标位置，生成并退出
-			it = GenerateRandTileVal();
-			break;
-		}
+		uhGame.Push(HistoryEntry{ engGame.TakeSnapshot(), dMove });
 
-		//检测必须在生成后，因为前面先进行递减然后才进行生成
-		if (u64EmptyCount == 0)//只要没有剩余空间，就进行合并检测
+		//只记录改变了棋盘的移动
+		if (fpRecord != NULL)
 		{
-			if (!HasPossibleMerges())//没有任何一个方向可以合并
-			{
-				enGameStatus = LostGame;//设置输
-			}
+			rrGame.Record(dMove);
 		}
-		
 		return true;
 	}
 
-	//====================移动合并====================
-	bool MoveOrMergeTile(const Pos &posMove, const Pos &posTarget, bool &bMerge)
+	//====================撤销重做====================
+	bool Undo(void)
 	{
-		if (GetTile(posTarget) == 0)
+		const HistoryEntry *pEntry = uhGame.Undo();
+		if (pEntry == NULL)
 		{
 			return false;
 		}
 
-		//新位置
-		Pos posNew = posTarget;
-		while (true)
+		engGame.RestoreSnapshot(pEntry->snGame);
+		if (fpRecord != NULL)
 		{
-			Pos posNext = posNew + posMove;//计算下一位置
-			if (!IsTilePosValid(posNext))//如果下一位置超出范围
-			{
-				break;//则跳过
-			}
-
-			if (GetTile(posNext) != 0)//如果下一位置非0
-			{
-				if (!bMerge || GetTile(posNext) != GetTile(posTarget))//当前不允许合并或值无法合并
-				{
-					break;//则跳过
-				}
-			}
-
-			//反之，当前索引没超出范围且posNext为0或可以合并
-
-			//移动到下一位置
-			posNew = posNext;
+			rrGame.PopMove();
 		}
+		return true;
+	}
 
-		//根本没有移动
-		if (posNew == posTarget)
+	bool Redo(void)
+	{
+		const HistoryEntry *pEntry = uhGame.Redo();
+		if (pEntry == NULL)
 		{
 			return false;
 		}
 
-		if (GetTile(posNew) == GetTile(posTarget))
+		engGame.RestoreSnapshot(pEntry->snGame);
+		if (fpRecord != NULL)
 		{
-			bMerge = false;//触发合并，下一次不允许合并
-			++u64EmptyCount;//合并后更新空位计数
+			rrGame.Record(pEntry->dMove);
 		}
-		else
-		{
-			bMerge = true;//本次无合并，下一次可以触发合并
-		}
-
-		//直接把值加到当前位置
-		//这样做，如果当前是0就相当于把值移动到当前位置，否则相当于合并值到当前位置，不用区分其他情况
-		GetTile(posNew) += GetTile(posTarget);
-		GetTile(posTarget) = 0;//清除原先的值
-
-		if (GetTile(posNew) == 2048)//如果任何一个合并获得2048
-		{
-			enGameStatus = WinGame;//则设置游戏状态为赢
-		}
-
 		return true;
 	}
 
-	bool ProcessMove(Direction dMove)
+	//====================回放记录====================
+	void FinishRecord(void)
 	{
-		if (enGameStatus != InGame)//不是游戏状态，直接退出
+		if (fpRecord == NULL || !rrGame.IsActive())
 		{
-			return false;
-		}
-
-		//判断方向，左右则水平，否则垂直
-		bool bHorizontal = (dMove == Lt || dMove == Rt);
-
-		//计算外层大小
-		int64_t i64OuterEnd = bHorizontal ? u64Height : u64Width;//外层仅结束有影响，固定从0开始到结尾
-
-		//计算内层大小
-		int64_t i64InnerBeg, i64InnerEnd, i64InnerStep;
-		if (dMove == Up || dMove == Lt)
-		{
-			i64InnerBeg = 1;//这里从1访问是因为第一排本身就是顶格的，没有移动的必要
-			i64InnerEnd = bHorizontal ? u64Width : u64Height;//正序上边界（不会访问）
-			i64InnerStep = 1;//正序
-		}
-		else
-		{
-			i64InnerBeg = (bHorizontal ? u64Width : u64Height) - 2;//这里从(bHorizontal ? u64Width : u64Height) - 2访问是因为最后一排本身就是顶格的，没有移动的必要
-			i64InnerEnd = -1;//倒序下边界（不会访问）
-			i64InnerStep = -1;//倒序
+			return;
 		}
 
+		rrGame.End(engGame.GetScore());
+		rrGame.WriteTo(fpRecord);
+		fflush(fpRecord);//每局结束立即落盘，异常退出也不会丢失已完成的局
+	}
 
-		//确认是否进行过移动
-		bool bMove = false;
-		for (int64_t i64Outer = 0; i64Outer != i64OuterEnd; ++i64Outer)//外层循环固定形式
-		{
-			//默认状态为可合并，对于移动方向的一排中的每两个只能存在一次合并，多排之间互不影响
-			//实际上，只要确认上一次是否发生过合并，如果发生过，那么本次不允许合并，就会进行堆放，下次则继续允许合并，这样就能完成防止重复合并的逻辑
-			bool bMerge = true;
-			for (int64_t i64Inner = i64InnerBeg; i64Inner != i64InnerEnd; i64Inner += i64InnerStep)//根据实际水平或垂直处理内层
-			{
-				Pos p = bHorizontal ? Pos{ i64Inner, i64Outer } : Pos{ i64Outer, i64Inner };
-				bool bRet = MoveOrMergeTile(arrMoveDir[dMove], p, bMerge);//移动与合并，合并时会设置是否赢，内部不会重复检测当前游戏状态，因为可能同时出现多个2048
-				bMove |= bRet;//返回值代表是否触发过合并或移动，以确认是否需要触发重绘与新值生成
-			}
-		}
+	//====================打印信息====================
+	void PrintGameBoard(void)//先把整个棋盘画进渲染器，再一次性输出与上一帧不同的部分
+	{
+		//从棋盘还原出数值
+		uint64_t u64Tile[u64Height][u64Width];
+		engGame.GetBoard().ToArray(u64Tile);
 
-		if (bMove && enGameStatus == InGame)//移动过且还是游戏状态，如果上面已经赢了，就没必要生成新值了，直接跳过
+		//按最大的数字决定这一帧的格子宽度
+		int iCellDigits = (int)u64MinCellDigits;
+		for (uint64_t u64Max = BitBoard::ExpToValue(engGame.GetBoard().MaxExp()); u64Max >= 10000; u64Max /= 10)
 		{
-			SpawnRandomTile();//这里会设置是否输
+			++iCellDigits;
 		}
+		size_t szGridCols = u64Width * (iCellDigits + 1) + 1;
 
-		return bMove;
-	}
+		char cBorder[u64MaxGridCols + 1];
+		memcpy(cBorder, arrBorder.data(), szGridCols);
+		cBorder[szGridCols] = '\0';
 
-	//====================打印信息====================
-	void PrintGameBoard(void) const//控制台起始坐标，注意不是从0开始的，行列都从1开始
-	{
-		//缓存一下，不要修改原始变量
-		uint16_t u16StartY = u16PrintStartY;
-		uint16_t u16StartX = u16PrintStartX;
+		crBoard.Clear();//宽度变窄时右边要清掉
 
-		printf("\033[?25l\033[%u;%uH", u16StartY, u16StartX);//\033[?25l 隐藏光标，每次都要设置因为用户修改控制台窗口后光标可能恢复显示
+		uint16_t u16Row = 0;
 		for (auto &arrRow : u64Tile)
 		{
-			printf("---------------------\033[%u;%uH", ++u16StartY, u16StartX);
+			crBoard.Draw(u16Row++, 0, cBorder);
+
+			char cLine[u64MaxGridCols + 2];
+			size_t szLen = 0;
 			for (auto u64Elem : arrRow)
 			{
 				if (u64Elem != 0)
 				{
-					printf("|%-4llu", u64Elem);
+					szLen += snprintf(cLine + szLen, sizeof(cLine) - szLen, "|%-*llu", iCellDigits, (unsigned long long)u64Elem);
 				}
 				else
 				{
-					printf("|%-4c", ' ');
+					szLen += snprintf(cLine + szLen, sizeof(cLine) - szLen, "|%-*c", iCellDigits, ' ');
 				}
 			}
-			printf("|\033[%u;%uH", ++u16StartY, u16StartX);
+			snprintf(cLine + szLen, sizeof(cLine) - szLen, "|");
+			crBoard.Draw(u16Row++, 0, cLine);
 		}
-		printf("---------------------\033[%u;%uH", ++u16StartY, u16StartX);
+		crBoard.Draw(u16Row, 0, cBorder);
+
+		crBoard.Flush();
 	}
 
-	bool ShowMessageAndPrompt(const char *pMessage, const char *pPrompt) const
+	//输出信息并询问，等待Y/N期间挂起协程
+	Game_Task<bool> ShowMessageAndPrompt(Input &kcInput, const char *pMessage, const char *pPrompt) const
 	{
 		//缓存一下，不要修改原始变量
 		uint16_t u16StartY = u16PrintStartY;
@@ -370,7 +244,12 @@ private:
 
 		//询问是否重开
 		printf("\033[%u;%uH%s (Y/N)", ++u16StartY, u16StartX, pPrompt);
-		auto waitKey = ci.WaitForKeys({ Console_Input::Keys::Y,Console_Input::Keys::SHIFT_Y,Console_Input::Keys::N,Console_Input::Keys::SHIFT_N });
+		Console_Input::Key waitKey;
+		do
+		{
+			waitKey = co_await kcInput.Next();
+		} while (waitKey != Console_Input::Keys::Y && waitKey != Console_Input::Keys::SHIFT_Y &&
+				 waitKey != Console_Input::Keys::N && waitKey != Console_Input::Keys::SHIFT_N);
 
 		//保存按键信息
 		bool bRet = false;
@@ -396,10 +275,10 @@ private:
 		ClearPrint(++u16StartY, u16StartX);
 
 		//最后返回
-		return bRet;
+		co_return bRet;
 	}
 
-	void PrintKeyInfo(void) const
+	void PrintKeyInfo(void)
 	{
 		//缓存一下，不要修改原始变量
 		uint16_t u16StartY = u16PrintStartY;
@@ -420,29 +299,28 @@ private:
 		printf(" A / Left Arrow  -> Left"); NewLine();
 		printf(" D / Right Arrow -> Right"); NewLine();
 		printf("-------------------------"); NewLine();
+		printf(" Z -> Undo"); NewLine();
+		printf(" X -> Redo"); NewLine();
 		printf(" R -> Restart"); NewLine();
 		printf(" Q -> Quit"); NewLine();
 		printf("-------------------------"); NewLine(2);
 
 		printf("Press Any key To Start...");
-
-		ci.WaitAnyKey();
-		printf("\033[2J\033[H");//清空屏幕并把光标回到左上角
 	}
 
 	//====================重置游戏====================
 	void ResetGame(void)
 	{
-		//清除格子数据
-		std::ranges::fill(u64TileFlatView, (uint64_t)0);
-		//设置空余的格子数为最大值
-		u64EmptyCount = u64TotalSize;
-		//设置游戏状态为游戏中
-		enGameStatus = InGame;
+		//上一局（如果有）写入回放，新一局从当前随机数位置开始记录
+		if (fpRecord != NULL)
+		{
+			FinishRecord();
+			rrGame.Begin((uint8_t)u64Width, (uint8_t)u64Height, u64Seed, 0, engGame.GetRandom().GetPosition(), dSpawnWeights_2, dSpawnWeights_4);
+		}
 
-		//在地图中随机两点生成
-		SpawnRandomTile();
-		SpawnRandomTile();
+		//清空并在地图中随机两点生成
+		engGame.Reset();
+		uhGame.Reset(HistoryEntry{ engGame.TakeSnapshot(), Direction::Enum_End });//新的一局不能撤销到上一局
 
 		//打印一次
 		PrintGameBoard();
@@ -455,7 +333,7 @@ private:
 
 		auto UpFunc = [&](auto &) -> long
 		{
-			return this->ProcessMove(Game2048::Up);
+			return this->ProcessMove(Direction::Up);
 		};
 		ci.RegisterKey(Console_Input::Keys::W, UpFunc);
 		ci.RegisterKey(Console_Input::Keys::SHIFT_W, UpFunc);
@@ -463,7 +341,7 @@ private:
 
 		auto LtFunc = [&](auto &) -> long
 		{
-			return this->ProcessMove(Game2048::Lt);
+			return this->ProcessMove(Direction::Lt);
 		};
 		ci.RegisterKey(Console_Input::Keys::A, LtFunc);
 		ci.RegisterKey(Console_Input::Keys::SHIFT_A, LtFunc);
@@ -471,7 +349,7 @@ private:
 
 		auto DnFunc = [&](auto &) -> long
 		{
-			return this->ProcessMove(Game2048::Dn);
+			return this->ProcessMove(Direction::Dn);
 		};
 		ci.RegisterKey(Console_Input::Keys::S, DnFunc);
 		ci.RegisterKey(Console_Input::Keys::SHIFT_S, DnFunc);
@@ -479,32 +357,37 @@ private:
 
 		auto RtFunc = [&](auto &) -> long
 		{
-			return this->ProcessMove(Game2048::Rt);
+			return this->ProcessMove(Direction::Rt);
 		};
 		ci.RegisterKey(Console_Input::Keys::D, RtFunc);
 		ci.RegisterKey(Console_Input::Keys::SHIFT_D, RtFunc);
 		ci.RegisterKey(Console_Input::Keys::RIGHT_ARROW, RtFunc);
 
-		auto RestartFunc = [&](auto &) -> long
+		auto UndoFunc = [&](auto &) -> long
 		{
-			if (this->ShowMessageAndPrompt("You Press Restart Key!", "Restart?"))
-			{
-				ResetGame();
-			}
+			return this->Undo();
+		};
+		ci.RegisterKey(Console_Input::Keys::Z, UndoFunc);
+		ci.RegisterKey(Console_Input::Keys::SHIFT_Z, UndoFunc);
+
+		auto RedoFunc = [&](auto &) -> long
+		{
+			return this->Redo();
+		};
+		ci.RegisterKey(Console_Input::Keys::X, RedoFunc);
+		ci.RegisterKey(Console_Input::Keys::SHIFT_X, RedoFunc);
 
-			return 0;//任何时候此调用都返回0，不论是否重开，因为不触发外部绘制（重开内部会绘制）
+		//询问需要等待按键，回调只提出请求，由游戏协程询问
+		auto RestartFunc = [&](auto &) -> long
+		{
+			return Key_Restart;
 		};
 		ci.RegisterKey(Console_Input::Keys::R, RestartFunc);
 		ci.RegisterKey(Console_Input::Keys::SHIFT_R, RestartFunc);
 
 		auto QuitFunc = [&](auto &) -> long
 		{
-			if (this->ShowMessageAndPrompt("You Press Quit Key!", "Quit?"))
-			{
-				return -1;//退出返回-1
-			}
-
-			return 0;//否则返回0，就当无事发生
+			return Key_Quit;
 		};
 		ci.RegisterKey(Console_Input::Keys::Q, QuitFunc);
 		ci.RegisterKey(Console_Input::Keys::SHIFT_Q, QuitFunc);
@@ -512,103 +395,166 @@ private:
 
 public:
 	//构造
-	Game2048(uint32_t u32Seed = std::random_device{}(), uint16_t _u16PrintStartX = 1, uint16_t _u16PrintStartY = 1, double dSpawnWeights_2 = 0.9, double dSpawnWeights_4 = 0.1) :
-		u64Tile{},
+	Game2048(uint32_t u32Seed = std::random_device{}(), uint16_t _u16PrintStartX = 1, uint16_t _u16PrintStartY = 1, double _dSpawnWeights_2 = 0.9, double _dSpawnWeights_4 = 0.1) :
+		engGame(u32Seed, _dSpawnWeights_2, _dSpawnWeights_4),
+		u64Seed(u32Seed),
+		dSpawnWeights_2(_dSpawnWeights_2),
+		dSpawnWeights_4(_dSpawnWeights_4),
 
-		u64EmptyCount(u64TotalSize),
-		enGameStatus(),
+		uhGame(),
+		rrGame(),
 
 		u16PrintStartX(_u16PrintStartX),
 		u16PrintStartY(_u16PrintStartY),
 
-		randGen(u32Seed),
-		valueDist({ dSpawnWeights_2, dSpawnWeights_4 }),
-		posDist()
+		crBoard(u64Height * 2 + 1, u64MaxGridCols, _u16PrintStartX, _u16PrintStartY)
 	{}
-	~Game2048(void) = default;//默认析构
+	~Game2048(void)
+	{
+		//退出时把未结束的一局也写入回放
+		FinishRecord();
+		if (fpRecord != NULL)
+		{
+			fclose(fpRecord);
+		}
+	}
 
-	//删除移动、拷贝方式
+	//删除移动、拷贝方式（终端状态不能复制，需要复制局面请直接拷贝Game2048_Engine）
 	Game2048(const Game2048 &) = delete;
 	Game2048(Game2048 &&) = delete;
 	Game2048 &operator=(const Game2048 &) = delete;
 	Game2048 &operator=(Game2048 &&) = delete;
 
-	//初始化
+	//把之后每一局追加记录到回放文件，需要在Init之前调用
+	bool StartRecording(const char *pPath)
+	{
+		fpRecord = fopen(pPath, "ab");
+		return fpRecord != NULL;
+	}
+
+	//初始化，之后由Run开始游戏
 	void Init(void)
 	{
-		//打印一次按键信息
-		PrintKeyInfo();
-		//这里必须先处理游戏
-		ResetGame();
-		//然后才注册按键，防止出现提前按键问题
+		//按键只在游戏协程中分发，注册后也不会出现提前按键问题
 		RegisterKey();
-		//初始化后，后续直接调用ResetGame则无问题
+#ifdef __linux__
+		//按住方向键时合并同一批到达的重复按键，松开后不会继续移动
+		Console_Input::SetCoalesce(true);
+#endif
 	}
-	
-	//循环
-	bool Loop(void)
+
+	//游戏流程：等待按键时挂起，按键由调用者从任意输入源放入kcInput，协程返回时游戏结束
+	Game_Task<void> Run(Input &kcInput)
 	{
-		switch (ci.AtLeastOne())//处理一次按键
-		{
-		default://其它返回，跳过处理
-		case 0://调用失败（没有移动）
-			return true;//直接返回
-			break;
-		case 1://调用成功
-			PrintGameBoard();//打印，不急着返回，后续判断输赢
-			break;
-		case -1://用户提前退出
-			return false;//直接返回
-		}
+		//打印一次按键信息，任意键开始
+		PrintKeyInfo();
+		co_await kcInput.Next();
+		printf("\033[2J\033[H");//清空屏幕并把光标回到左上角
+		crBoard.Invalidate();//屏幕已清空，下一帧全量重绘
 
-		switch (enGameStatus)//判断一下输赢
+		ResetGame();
+
+		//调试
+#ifdef _DEBUG
+		Debug();
+#endif
+
+		while (true)
 		{
-		case Game2048::WinGame:
-			if (!ShowMessageAndPrompt("You Win!", "Restart?"))
+			//等到一个按键，再处理已经到达的所有按键，最后只绘制一次
+			//遇到需要询问的按键就停下，之后的按键留给询问
+			bool bRedraw = false;
+			long lAsk = Key_None;
+			Console_Input::Key stKey = co_await kcInput.Next();
+			do
 			{
-				return false;//退出
+				long lRet = Key_None;
+				if (!ci.Trigger(stKey, lRet))//未注册的按键跳过
+				{
+					continue;
+				}
+
+				bRedraw = bRedraw || lRet == Key_Redraw;
+				if (lRet == Key_Restart || lRet == Key_Quit)
+				{
+					lAsk = lRet;
+					break;
+				}
+			} while (kcInput.TryPop(stKey));
+
+			if (bRedraw)
+			{
+				PrintGameBoard();
 			}
-			ResetGame();//重置
-			break;
-		case Game2048::LostGame:
-			if (!ShowMessageAndPrompt("You Lost...", "Restart?"))
+
+			//用户按下重开或退出
+			if (lAsk == Key_Restart)
+			{
+				if (co_await ShowMessageAndPrompt(kcInput, "You Press Restart Key!", "Restart?"))
+				{
+					ResetGame();//重开内部会绘制
+				}
+				continue;
+			}
+			if (lAsk == Key_Quit)
 			{
-				return false;//退出
+				if (co_await ShowMessageAndPrompt(kcInput, "You Press Quit Key!", "Quit?"))
+				{
+					co_return;//退出
+				}
+				continue;//否则就当无事发生
 			}
-			ResetGame();//重置
-			break;
-		default:
-			break;
-		}
 
-		return true;//返回true继续循环，否则跳出结束程序
+			if (!bRedraw)//没有移动，不用判断输赢
+			{
+				continue;
+			}
+
+			switch (engGame.GetStatus())//判断一下输赢
+			{
+			case GameStatus::WinGame:
+				if (!co_await ShowMessageAndPrompt(kcInput, "You Win!", "Restart?"))
+				{
+					co_return;//退出
+				}
+				ResetGame();//重置
+				break;
+			case GameStatus::LostGame:
+				if (!co_await ShowMessageAndPrompt(kcInput, "You Lost...", "Restart?"))
+				{
+					co_return;//退出
+				}
+				ResetGame();//重置
+				break;
+			default:
+				break;
+			}
+		}
 	}
 
 	//调试
 #ifdef _DEBUG
 	void Debug(void)
 	{
-		u64Tile[0][0] = 2;
-		u64Tile[0][1] = 2;
-		u64Tile[0][2] = 2;
-		u64Tile[0][3] = 2;
-
-		u64Tile[1][0] = 2;
-		u64Tile[1][1] = 2;
-		u64Tile[1][2] = 4;
-		u64Tile[1][3] = 0;
-
-		u64Tile[2][0] = 4;
-		u64Tile[2][1] = 2;
-		u64Tile[2][2] = 2;
-		u64Tile[2][3] = 2;
+		constexpr const static uint64_t u64Pattern[4][4] =
+		{
+			{ 2, 2, 2, 2 },
+			{ 2, 2, 4, 0 },
+			{ 4, 2, 2, 2 },
+			{ 2, 2, 0, 2 },
+		};
 
-		u64Tile[3][0] = 2;
-		u64Tile[3][1] = 2;
-		u64Tile[3][2] = 0;
-		u64Tile[3][3] = 2;
+		//棋盘尺寸不同，只拷贝能放下的部分
+		uint64_t u64Tile[u64Height][u64Width]{};
+		for (uint64_t Y = 0; Y < u64Height && Y < 4; ++Y)
+		{
+			for (uint64_t X = 0; X < u64Width && X < 4; ++X)
+			{
+				u64Tile[Y][X] = u64Pattern[Y][X];
+			}
+		}
 
-		u64EmptyCount = 2;
+		engGame.SetBoard(Engine::Board::FromArray(u64Tile));
 
 		PrintGameBoard();
 	}
@@ -651,25 +597,125 @@ bool EnableVirtualTerminalProcessing(void)
 #define INIT_CONSOLE() (void)0  //空操作
 #endif
 
-int main(void)
+template<uint64_t W, uint64_t H>
+int PlayGame(const char *pRecordPath)
 {
-	INIT_CONSOLE();//Windows福报
+	Game2048<W, H> game{};
 
-	Game2048 game{};
+	//记录回放
+	if (pRecordPath != NULL && !game.StartRecording(pRecordPath))
+	{
+		fprintf(stderr, "Error: cannot open record file %s\n", pRecordPath);
+		return 1;
+	}
 
 	//初始化
 	game.Init();
 
-	//调试
-#ifdef _DEBUG
-	game.Debug();
-#endif
-	
-	//游戏循环
-	while (game.Loop())
+	//终端是这一局唯一的输入源：阻塞等一个按键，再把已经到达的按键一起放入通道，然后运行就绪的协程
+	Coroutine_Scheduler csMain{};
+	typename Game2048<W, H>::Input kcInput{ csMain };
+	Game_Task<void> gtGame = game.Run(kcInput);
+	gtGame.Start();
+	while (!gtGame.Done())
 	{
-		continue;
+		kcInput.Push(Console_Input::WaitAnyKey());
+		try
+		{
+			while (!kcInput.Full() && Console_Input::InputExists())
+			{
+				kcInput.Push(Console_Input::WaitAnyKey());
+			}
+		}
+		catch (const std::runtime_error &)
+		{
+			//输入已经结束（例如从管道读入），先处理完已经读到的按键，游戏还没结束才报错
+			csMain.RunReady();
+			if (!gtGame.Done())
+			{
+				throw;
+			}
+			break;
+		}
+
+		csMain.RunReady();
 	}
+	gtGame.Result();//协程中的异常在这里抛出
 
 	return 0;
 }
+
+int main(int argc, char *argv[])
+{
+	//编译时定义了GAME2048_STATS才有效：退出时（非Windows下收到SIGUSR1时也会）输出运行统计
+	Game2048_Stats::Install();
+
+	//无界面批量模拟，不需要初始化控制台
+	if (argc >= 2 && strcmp(argv[1], "--batch") == 0)
+	{
+		return Batch_Simulation::Main(argc, argv);
+	}
+
+	//N元组网络的自我对弈训练
+	if (argc >= 2 && strcmp(argv[1], "--train") == 0)
+	{
+		return NTuple_Trainer::Main(argc, argv);
+	}
+
+	//回放文件重放，同样不需要控制台
+	if (argc >= 2 && strcmp(argv[1], "--replay") == 0)
+	{
+		return Replay_Player::Main(argc, argv);
+	}
+
+	//并行校验回放文件、目录或标准输入
+	if (argc >= 2 && strcmp(argv[1], "--verify") == 0)
+	{
+		return Replay_Verifier::Main(argc, argv);
+	}
+
+#ifdef __linux__
+	//本地Unix套接字上的多会话服务器，一个进程服务所有玩家
+	if (argc >= 2 && strcmp(argv[1], "--serve") == 0)
+	{
+		return Session_Server::Main(argc, argv);
+	}
+#endif
+
+	//--size N 选择棋盘尺寸，每种尺寸都是单独实例化的模板
+	//--record FILE 把每一局追加记录到回放文件
+	uint64_t u64Size = 4;
+	const char *pRecordPath = NULL;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--size") == 0)
+		{
+			u64Size = strtoull(argv[i + 1], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--record") == 0)
+		{
+			pRecordPath = argv[i + 1];
+		}
+	}
+
+	INIT_CONSOLE();//Windows福报
+
+	switch (u64Size)
+	{
+	case 3:
+		return PlayGame<3, 3>(pRecordPath);
+	case 4:
+		return PlayGame<4, 4>(pRecordPath);
+	case 5:
+		return PlayGame<5, 5>(pRecordPath);
+	case 6:
+		return PlayGame<6, 6>(pRecordPath);
+	case 8:
+		return PlayGame<8, 8>(pRecordPath);
+	case 16:
+		return PlayGame<16, 16>(pRecordPath);
+	default:
+		fprintf(stderr, "Error: unsupported board size %llu (3~6, 8, 16)\n", (unsigned long long)u64Size);
+		return 1;
+	}
+}